@@ -8,10 +8,47 @@
 #ifndef _ARCH_H_
 #define	_ARCH_H_
 
-#define atomic_int_inc(atomic) (atomic_int_add((atomic), 1))
+/*
+ * Atomic operations of libscm.
+ *
+ * By default the C11 atomics of <stdatomic.h> are used with the weakest
+ * memory order that is correct for the respective counter:
+ *
+ *  - descriptor counters are incremented with relaxed order. The increment
+ *    only has to be atomic, the object is published to other threads by
+ *    other means before they may refresh it.
+ *  - descriptor counters are decremented with acquire-release order. The
+ *    thread that drops the counter to zero frees the object and must see
+ *    all writes made by threads that decremented before.
+ *  - the finalizer index is claimed with relaxed order, every index is
+ *    handed out exactly once.
+ *  - the global time is loaded with acquire and stored with release order,
+ *    the countdown of ticked threads is decremented with acquire-release
+ *    order, see scm_global_tick.
+ *  - pointers are pushed to lock-free stacks with release order and the
+ *    stacks are taken as a whole with acquire order, see pool.c.
+ *  - the links of the lock-free containers are loaded with acquire order
+ *    and changed with sequentially consistent compare-and-exchange, see
+ *    containers.c.
+ *
+ * The counters are plain ints in the object header and in the region
+ * and accessed through atomic_int pointers, which have the same size and
+ * alignment as int on all targets supported by gcc.
+ *
+ * Compiling with SCM_ATOMICS_ASM selects the former x86 inline assembler,
+ * in which every read-modify-write operation is a full barrier.
+ */
+
+#if defined SCM_ATOMICS_ASM && !(defined __i386__ || defined __x86_64__)
+#error "SCM_ATOMICS_ASM requires an x86 target"
+#endif
 
+// counter increment, e.g. of the descriptor counter on refresh
+#define atomic_int_inc(atomic) (atomic_int_add_relaxed((atomic), 1))
+
+// counter decrement, true if the counter dropped to zero
 #define atomic_int_dec_and_test(atomic)	\
- (atomic_int_exchange_and_add((atomic), -1) == 1)
+ (atomic_int_exchange_and_add_acq_rel((atomic), -1) == 1)
 
 static inline void toggle_bit_at_pos(int *bitmap, int pos) {
     *bitmap = *bitmap ^ (1 << pos);
@@ -59,6 +96,46 @@ static inline int bsrl(int bitmap) {
     return result;
 }
 
+#else /* !(defined __i386__ || defined __x86_64__) */
+
+#if defined __aarch64__
+
+// the virtual counter of the generic timer, which ticks at a constant rate
+static inline unsigned long long rdtsc(void) {
+    unsigned long long ticks;
+    asm volatile ("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+}
+
+#else /* !defined __aarch64__ */
+
+#include <time.h>
+
+// nanoseconds instead of cycles
+static inline unsigned long long rdtsc(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned long long) now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+#endif /* defined __aarch64__ */
+
+/* bit scan forward returns the index of the LEAST significant bit
+ * or -1 if bitmap==0 */
+static inline int bsfl(int bitmap) {
+    return bitmap == 0 ? -1 : __builtin_ctz((unsigned int) bitmap);
+}
+
+/* bit scan reverse returns the index of the MOST significant bit
+ * or -1 if bitmap==0 */
+static inline int bsrl(int bitmap) {
+    return bitmap == 0 ? -1 : 31 - __builtin_clz((unsigned int) bitmap);
+}
+
+#endif /* defined __i386__ || defined __x86_64__ */
+
+#ifdef SCM_ATOMICS_ASM
+
 /*code adapted from glib http://ftp.gnome.org/pub/gnome/sources/glib/2.24/
  * g_atomic_*: atomic operations.
  * Copyright (C) 2003 Sebastian Wilhelmi
@@ -94,6 +171,151 @@ static inline int atomic_int_compare_and_exchange(volatile int *atomic,
     return result;
 }
 
-#endif /* defined __i386__ || defined __x86_64__ */
+// xchg with a memory operand is locked implicitly
+static inline int atomic_int_exchange(volatile int *atomic, int val) {
+    __asm__ __volatile__("xchgl %0, %1"
+            : "=r" (val), "+m" (*atomic)
+            : "0" (val)
+            : "memory");
+    return val;
+}
+
+// locked instructions are full barriers, there are no weaker variants
+#define atomic_int_add_relaxed(atomic, val) atomic_int_add((atomic), (val))
+#define atomic_int_exchange_and_add_relaxed(atomic, val) \
+    atomic_int_exchange_and_add((atomic), (val))
+#define atomic_int_exchange_and_add_acq_rel(atomic, val) \
+    atomic_int_exchange_and_add((atomic), (val))
+
+static inline void *atomic_pointer_exchange_acquire(void * volatile *atomic,
+        void *val) {
+    __asm__ __volatile__("xchg %0, %1"
+            : "=r" (val), "+m" (*atomic)
+            : "0" (val)
+            : "memory");
+    return val;
+}
+
+static inline void *atomic_pointer_compare_and_exchange_release(
+        void * volatile *atomic, void *oldval, void *newval) {
+    return __sync_val_compare_and_swap(atomic, oldval, newval);
+}
+
+static inline void *atomic_pointer_compare_and_exchange(
+        void * volatile *atomic, void *oldval, void *newval) {
+    return __sync_val_compare_and_swap(atomic, oldval, newval);
+}
+
+// aligned loads and stores are atomic on x86 and ordered by the hardware,
+// the compiler barrier keeps gcc from moving memory accesses across them
+static inline void *atomic_pointer_load_acquire(void * volatile *atomic) {
+    void *result = *atomic;
+    __asm__ __volatile__("" ::: "memory");
+    return result;
+}
+
+static inline long atomic_long_load_acquire(volatile long *atomic) {
+    long result = *atomic;
+    __asm__ __volatile__("" ::: "memory");
+    return result;
+}
+
+static inline void atomic_long_store_release(volatile long *atomic,
+        long val) {
+    __asm__ __volatile__("" ::: "memory");
+    *atomic = val;
+}
+
+#else /* !SCM_ATOMICS_ASM */
+
+#include <stdatomic.h>
+
+/* read-modify-write operations with sequential consistency, equivalent to
+ * the assembler variants */
+static inline int atomic_int_exchange_and_add(volatile int *atomic,
+        int val) {
+    return atomic_fetch_add((volatile atomic_int*) atomic, val);
+}
+
+static inline void atomic_int_add(volatile int *atomic, int val) {
+    atomic_fetch_add((volatile atomic_int*) atomic, val);
+}
+
+/* returns the value of *atomic before the operation, which is equal to
+ * oldval if newval was stored */
+static inline int atomic_int_compare_and_exchange(volatile int *atomic,
+        int oldval, int newval) {
+    atomic_compare_exchange_strong((volatile atomic_int*) atomic,
+            &oldval, newval);
+    return oldval;
+}
+
+/* returns the value of *atomic before val was stored */
+static inline int atomic_int_exchange(volatile int *atomic, int val) {
+    return atomic_exchange((volatile atomic_int*) atomic, val);
+}
+
+/* operations with the memory orders described above */
+static inline void atomic_int_add_relaxed(volatile int *atomic, int val) {
+    atomic_fetch_add_explicit((volatile atomic_int*) atomic, val,
+            memory_order_relaxed);
+}
+
+static inline int atomic_int_exchange_and_add_relaxed(volatile int *atomic,
+        int val) {
+    return atomic_fetch_add_explicit((volatile atomic_int*) atomic, val,
+            memory_order_relaxed);
+}
+
+static inline int atomic_int_exchange_and_add_acq_rel(volatile int *atomic,
+        int val) {
+    return atomic_fetch_add_explicit((volatile atomic_int*) atomic, val,
+            memory_order_acq_rel);
+}
+
+/* a pointer is taken with acquire order and published with release order,
+ * e.g. for stacks that other threads push to and the owner empties */
+static inline void *atomic_pointer_exchange_acquire(void * volatile *atomic,
+        void *val) {
+    return atomic_exchange_explicit((void * _Atomic volatile *) atomic, val,
+            memory_order_acquire);
+}
+
+/* returns the value of *atomic before the operation, which is equal to
+ * oldval if newval was stored */
+static inline void *atomic_pointer_compare_and_exchange_release(
+        void * volatile *atomic, void *oldval, void *newval) {
+    atomic_compare_exchange_strong_explicit(
+            (void * _Atomic volatile *) atomic, &oldval, newval,
+            memory_order_release, memory_order_relaxed);
+    return oldval;
+}
+
+/* returns the value of *atomic before the operation, which is equal to
+ * oldval if newval was stored */
+static inline void *atomic_pointer_compare_and_exchange(
+        void * volatile *atomic, void *oldval, void *newval) {
+    atomic_compare_exchange_strong((void * _Atomic volatile *) atomic,
+            &oldval, newval);
+    return oldval;
+}
+
+static inline void *atomic_pointer_load_acquire(void * volatile *atomic) {
+    return atomic_load_explicit((void * _Atomic volatile *) atomic,
+            memory_order_acquire);
+}
+
+static inline long atomic_long_load_acquire(volatile long *atomic) {
+    return atomic_load_explicit((volatile atomic_long*) atomic,
+            memory_order_acquire);
+}
+
+static inline void atomic_long_store_release(volatile long *atomic,
+        long val) {
+    atomic_store_explicit((volatile atomic_long*) atomic, val,
+            memory_order_release);
+}
+
+#endif /* SCM_ATOMICS_ASM */
 
 #endif	/* _ARCH_H_ */
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+#ifndef _BENCH_H_
+#define	_BENCH_H_
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Helpers shared by the libscm benchmarks in bench/. Every benchmark is
+ * built once per allocator, selected with one of the following flags:
+ *
+ *  MALLOC_ONLY    explicit malloc/free (baseline)
+ *  STM_MALLOC     short-term memory: scm_malloc/scm_refresh/scm_tick
+ *  STR_MALLOC     short-term regions: scm_malloc_in_region/scm_refresh_region
+ *  STRMC_MALLOC   short-term regions with multiple clocks
+ */
+
+#if defined STM_MALLOC || defined STR_MALLOC || defined STRMC_MALLOC
+#include "libscm.h"
+#define BENCH_USES_LIBSCM 1
+#endif
+
+#if defined STM_MALLOC
+#define BENCH_MODE "STM"
+#elif defined STR_MALLOC
+#define BENCH_MODE "STR"
+#elif defined STRMC_MALLOC
+#define BENCH_MODE "STRMC"
+#else
+#define BENCH_MODE "MALLOC"
+#endif
+
+/* cycle counter used to attribute costs to individual calls */
+static inline uint64_t bench_cycles(void) {
+#if defined __i386__ || defined __x86_64__
+    unsigned hi, lo;
+    __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t) lo) | (((uint64_t) hi) << 32);
+#elif defined __aarch64__
+    uint64_t ticks;
+    __asm__ __volatile__ ("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#endif
+}
+
+/* wall clock time in nanoseconds */
+static inline uint64_t bench_nsec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* resident set size of the process in kilobytes, 0 if unavailable */
+static inline long bench_rss_kb(void) {
+    long pages = 0, resident = 0;
+    FILE *statm = fopen("/proc/self/statm", "r");
+
+    if (statm == NULL) return 0;
+
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(statm);
+
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+/* parses a positive numeric command line option, exits on error */
+static inline unsigned long bench_parse_ul(const char *option,
+        const char *value) {
+    char *end;
+    unsigned long result = strtoul(value, &end, 10);
+
+    if (*value == '\0' || *end != '\0' || result == 0) {
+        fprintf(stderr, "Invalid value for %s: %s\n", option, value);
+        exit(-1);
+    }
+    return result;
+}
+
+#endif	/* _BENCH_H_ */
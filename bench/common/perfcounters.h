@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+#ifndef _PERFCOUNTERS_H_
+#define	_PERFCOUNTERS_H_
+
+/*
+ * Optional hardware counter instrumentation of benchmark phases.
+ *
+ * Compile a benchmark with -DPERF_COUNTERS (e.g. make
+ * BENCH_OPTION=-DPERF_COUNTERS) to wrap its measured phases with
+ * perf_event_open counters. Each phase owns a perf_phase_t; the counters of
+ * a phase are only enabled between PERF_PHASE_START and PERF_PHASE_STOP, so
+ * a phase that is entered many times accumulates its counts.
+ * PERF_PHASE_REPORT prints the counts divided by the number of operations
+ * executed in the phase:
+ *
+ *  perf <phase> <event> <count per operation>
+ *
+ * The hardware events are cycles, instructions, cache misses and dTLB load
+ * misses. If the hardware PMU cannot be accessed (virtual machines,
+ * perf_event_paranoid) the phase falls back to software events: task clock,
+ * page faults, context switches and cpu migrations. Events that cannot be
+ * opened are reported as n/a.
+ *
+ * Counters count the calling thread only. Multi-threaded benchmarks use one
+ * perf_phase_t per thread and PERF_PHASE_MERGE the results into a phase
+ * initialized with PERF_PHASE_INIT_TOTAL.
+ *
+ * Enabling and disabling the counters costs two system calls per event, so
+ * a phase should cover many operations.
+ */
+
+#ifdef PERF_COUNTERS
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define PERF_NUMBER_OF_EVENTS 4
+
+typedef struct perf_event_spec perf_event_spec_t;
+
+struct perf_event_spec {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+};
+
+static const perf_event_spec_t perf_hardware_events[PERF_NUMBER_OF_EVENTS] = {
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+    { "cache-misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+    { "dTLB-load-misses", PERF_TYPE_HW_CACHE,
+        PERF_COUNT_HW_CACHE_DTLB
+        | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+        | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) }
+};
+
+static const perf_event_spec_t perf_software_events[PERF_NUMBER_OF_EVENTS] = {
+    { "task-clock-ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+    { "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    { "context-switches", PERF_TYPE_SOFTWARE,
+        PERF_COUNT_SW_CONTEXT_SWITCHES },
+    { "cpu-migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS }
+};
+
+typedef struct perf_phase perf_phase_t;
+
+struct perf_phase {
+    const char *name;
+
+    // either perf_hardware_events or perf_software_events
+    const perf_event_spec_t *events;
+
+    // -1 if the event could not be opened
+    int fds[PERF_NUMBER_OF_EVENTS];
+
+    // counts and operations of closed or merged phases
+    uint64_t counts[PERF_NUMBER_OF_EVENTS];
+    int available[PERF_NUMBER_OF_EVENTS];
+    unsigned long operations;
+};
+
+static inline int perf_open_event(const perf_event_spec_t *spec) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = spec->type;
+    attr.config = spec->config;
+    attr.disabled = 1;
+    // user space only, works with perf_event_paranoid <= 2
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED
+            | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/*
+ * Opens the counters of a phase for the calling thread. Falls back to
+ * software events if none of the hardware events is available.
+ */
+static inline void perf_phase_init(perf_phase_t *phase, const char *name) {
+    int i, opened = 0;
+
+    memset(phase, 0, sizeof(perf_phase_t));
+    phase->name = name;
+    phase->events = perf_hardware_events;
+
+    for (i = 0; i < PERF_NUMBER_OF_EVENTS; i++) {
+        phase->fds[i] = perf_open_event(&phase->events[i]);
+        if (phase->fds[i] >= 0) opened++;
+    }
+
+    if (opened == 0) {
+        phase->events = perf_software_events;
+
+        for (i = 0; i < PERF_NUMBER_OF_EVENTS; i++) {
+            phase->fds[i] = perf_open_event(&phase->events[i]);
+        }
+    }
+
+    for (i = 0; i < PERF_NUMBER_OF_EVENTS; i++) {
+        phase->available[i] = phase->fds[i] >= 0;
+    }
+}
+
+static inline void perf_phase_start(perf_phase_t *phase) {
+    int i;
+
+    for (i = 0; i < PERF_NUMBER_OF_EVENTS; i++) {
+        if (phase->fds[i] >= 0) {
+            ioctl(phase->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+static inline void perf_phase_stop(perf_phase_t *phase,
+        unsigned long operations) {
+    int i;
+
+    for (i = 0; i < PERF_NUMBER_OF_EVENTS; i++) {
+        if (phase->fds[i] >= 0) {
+            ioctl(phase->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+    phase->operations += operations;
+}
+
+/*
+ * Reads and closes the counters of a phase. Counts are scaled if the kernel
+ * multiplexed the counters.
+ */
+static inline void perf_phase_close(perf_phase_t *phase) {
+    int i;
+
+    for (i = 0; i < PERF_NUMBER_OF_EVENTS; i++) {
+        uint64_t value[3];
+
+        if (phase->fds[i] < 0) continue;
+
+        if (read(phase->fds[i], value, sizeof(value)) == sizeof(value)) {
+            if (value[2] != 0 && value[2] < value[1]) {
+                value[0] = (uint64_t) ((double) value[0] * value[1]
+                        / value[2]);
+            }
+            phase->counts[i] += value[0];
+        }
+        close(phase->fds[i]);
+        phase->fds[i] = -1;
+    }
+}
+
+/*
+ * Initializes a phase that only collects the counts of other phases.
+ */
+static inline void perf_phase_init_total(perf_phase_t *phase,
+        const char *name) {
+    int i;
+
+    memset(phase, 0, sizeof(perf_phase_t));
+    phase->name = name;
+
+    for (i = 0; i < PERF_NUMBER_OF_EVENTS; i++) {
+        phase->fds[i] = -1;
+    }
+}
+
+/*
+ * Adds the (closed) counts of a per-thread phase to a total phase.
+ */
+static inline void perf_phase_merge(perf_phase_t *into, perf_phase_t *from) {
+    int i;
+
+    perf_phase_close(from);
+
+    if (into->events == NULL) {
+        into->events = from->events;
+    }
+    for (i = 0; i < PERF_NUMBER_OF_EVENTS; i++) {
+        into->counts[i] += from->counts[i];
+        into->available[i] |= from->available[i];
+    }
+    into->operations += from->operations;
+}
+
+static inline void perf_phase_report(perf_phase_t *phase) {
+    int i;
+
+    perf_phase_close(phase);
+
+    if (phase->events == NULL) return;
+
+    for (i = 0; i < PERF_NUMBER_OF_EVENTS; i++) {
+        if (!phase->available[i]) {
+            printf("perf %s %s n/a\n", phase->name, phase->events[i].name);
+        } else if (phase->operations == 0) {
+            printf("perf %s %s %lu\n", phase->name, phase->events[i].name,
+                    (unsigned long) phase->counts[i]);
+        } else {
+            printf("perf %s %s %.2f\n", phase->name, phase->events[i].name,
+                    (double) phase->counts[i] / phase->operations);
+        }
+    }
+}
+
+#define PERF_PHASE(_phase) perf_phase_t _phase;
+#define PERF_PHASE_INIT(_phase, _name) perf_phase_init(&(_phase), _name)
+#define PERF_PHASE_INIT_TOTAL(_phase, _name) \
+    perf_phase_init_total(&(_phase), _name)
+#define PERF_PHASE_START(_phase) perf_phase_start(&(_phase))
+#define PERF_PHASE_STOP(_phase, _operations) \
+    perf_phase_stop(&(_phase), _operations)
+#define PERF_PHASE_MERGE(_into, _from) perf_phase_merge(&(_into), &(_from))
+#define PERF_PHASE_REPORT(_phase) perf_phase_report(&(_phase))
+
+#else
+
+#define PERF_PHASE(_phase) //NOOP
+#define PERF_PHASE_INIT(_phase, _name) //NOOP
+#define PERF_PHASE_INIT_TOTAL(_phase, _name) //NOOP
+#define PERF_PHASE_START(_phase) //NOOP
+#define PERF_PHASE_STOP(_phase, _operations) //NOOP
+#define PERF_PHASE_MERGE(_into, _from) //NOOP
+#define PERF_PHASE_REPORT(_phase) //NOOP
+
+#endif  /* PERF_COUNTERS */
+
+#endif	/* _PERFCOUNTERS_H_ */
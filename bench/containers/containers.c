@@ -0,0 +1,504 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+/*
+ * Container benchmark.
+ *
+ * Threads operate on a shared queue, hash map and skip list. containersSTM
+ * uses the lock-free containers of libscm, whose nodes are reclaimed with
+ * scm_retire and scm_quiescent, containersMALLOC the same containers
+ * protected by pthread mutexes with malloc and free:
+ *
+ *  queue      one mutex for the whole queue
+ *  map        one mutex per bucket
+ *  skiplist   one mutex for the whole skip list
+ *
+ * Every queue operation is an enqueue followed by a dequeue. The map and
+ * the skip list are filled with half of the keys, then every operation is
+ * a lookup or, with the update percentage, a put or remove of a random key.
+ * Reports operations per second of every container. With libscm the
+ * threads pass through a quiescent state every QUIESCENT_INTERVAL
+ * operations, which amortizes the global ticks.
+ *
+ * Options:
+ *  -t threads      number of threads (default 4)
+ *  -o operations   operations per thread and container (default 1000000)
+ *  -k keys         size of the key range (default 65536)
+ *  -u percent      percentage of updates (default 20)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "bench.h"
+
+#define MAP_BUCKETS 1024
+#define QUIESCENT_INTERVAL 32
+#define SKIPLIST_MAX_LEVEL 20
+
+static unsigned long number_of_threads = 4;
+static unsigned long operations_per_thread = 1000000;
+static unsigned long number_of_keys = 65536;
+static unsigned long update_percentage = 20;
+
+#ifdef BENCH_USES_LIBSCM
+
+typedef scm_queue_t queue_t;
+typedef scm_map_t map_t;
+typedef scm_skiplist_t skiplist_t;
+
+#define queue_create() scm_queue_create()
+#define queue_enqueue(_queue, _value) scm_queue_enqueue(_queue, _value)
+#define queue_dequeue(_queue) scm_queue_dequeue(_queue)
+#define map_create() scm_map_create(MAP_BUCKETS)
+#define map_put(_map, _key, _value) scm_map_put(_map, _key, _value)
+#define map_get(_map, _key) scm_map_get(_map, _key)
+#define map_remove(_map, _key) scm_map_remove(_map, _key)
+#define skiplist_create() scm_skiplist_create()
+#define skiplist_put(_list, _key, _value) scm_skiplist_put(_list, _key, _value)
+#define skiplist_get(_list, _key) scm_skiplist_get(_list, _key)
+#define skiplist_remove(_list, _key) scm_skiplist_remove(_list, _key)
+
+// the threads hold no references to nodes between two operations
+#define QUIESCENT() scm_quiescent()
+
+#else
+
+typedef struct node node_t;
+
+struct node {
+    unsigned long key;
+    void *value;
+    node_t *next;
+};
+
+typedef struct queue {
+    pthread_mutex_t lock;
+    node_t *head;
+    node_t *tail;
+} queue_t;
+
+typedef struct bucket {
+    pthread_mutex_t lock;
+    node_t *head;
+} bucket_t;
+
+typedef struct map {
+    bucket_t buckets[MAP_BUCKETS];
+} map_t;
+
+typedef struct skiplist_node skiplist_node_t;
+
+struct skiplist_node {
+    unsigned long key;
+    void *value;
+    skiplist_node_t *next[];
+};
+
+typedef struct skiplist {
+    pthread_mutex_t lock;
+    skiplist_node_t *head;
+} skiplist_t;
+
+static queue_t *queue_create(void) {
+    queue_t *queue = calloc(1, sizeof(queue_t));
+
+    pthread_mutex_init(&queue->lock, NULL);
+    return queue;
+}
+
+static int queue_enqueue(queue_t *queue, void *value) {
+    node_t *node = malloc(sizeof(node_t));
+
+    if (node == NULL) return -1;
+
+    node->value = value;
+    node->next = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+    if (queue->tail == NULL) {
+        queue->head = node;
+    } else {
+        queue->tail->next = node;
+    }
+    queue->tail = node;
+    pthread_mutex_unlock(&queue->lock);
+
+    return 0;
+}
+
+static void *queue_dequeue(queue_t *queue) {
+    pthread_mutex_lock(&queue->lock);
+    node_t *node = queue->head;
+
+    if (node == NULL) {
+        pthread_mutex_unlock(&queue->lock);
+        return NULL;
+    }
+
+    queue->head = node->next;
+    if (queue->head == NULL) queue->tail = NULL;
+    pthread_mutex_unlock(&queue->lock);
+
+    void *value = node->value;
+    free(node);
+
+    return value;
+}
+
+static map_t *map_create(void) {
+    map_t *map = calloc(1, sizeof(map_t));
+    int i;
+
+    for (i = 0; i < MAP_BUCKETS; i++) {
+        pthread_mutex_init(&map->buckets[i].lock, NULL);
+    }
+    return map;
+}
+
+static inline bucket_t *bucket_of(map_t *map, unsigned long key) {
+    unsigned long long hash = key * 11400714819323198485ULL;
+
+    return &map->buckets[(hash >> 32) & (MAP_BUCKETS - 1)];
+}
+
+static int map_put(map_t *map, unsigned long key, void *value) {
+    bucket_t *bucket = bucket_of(map, key);
+    node_t *node;
+
+    pthread_mutex_lock(&bucket->lock);
+    for (node = bucket->head; node != NULL; node = node->next) {
+        if (node->key == key) {
+            node->value = value;
+            pthread_mutex_unlock(&bucket->lock);
+            return 0;
+        }
+    }
+
+    node = malloc(sizeof(node_t));
+    if (node != NULL) {
+        node->key = key;
+        node->value = value;
+        node->next = bucket->head;
+        bucket->head = node;
+    }
+    pthread_mutex_unlock(&bucket->lock);
+
+    return node == NULL ? -1 : 0;
+}
+
+static void *map_get(map_t *map, unsigned long key) {
+    bucket_t *bucket = bucket_of(map, key);
+    node_t *node;
+    void *value = NULL;
+
+    pthread_mutex_lock(&bucket->lock);
+    for (node = bucket->head; node != NULL; node = node->next) {
+        if (node->key == key) {
+            value = node->value;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&bucket->lock);
+
+    return value;
+}
+
+static void *map_remove(map_t *map, unsigned long key) {
+    bucket_t *bucket = bucket_of(map, key);
+    node_t **link;
+    node_t *node = NULL;
+
+    pthread_mutex_lock(&bucket->lock);
+    for (link = &bucket->head; *link != NULL; link = &(*link)->next) {
+        if ((*link)->key == key) {
+            node = *link;
+            *link = node->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&bucket->lock);
+
+    if (node == NULL) return NULL;
+
+    void *value = node->value;
+    free(node);
+
+    return value;
+}
+
+static skiplist_t *skiplist_create(void) {
+    skiplist_t *list = calloc(1, sizeof(skiplist_t));
+
+    pthread_mutex_init(&list->lock, NULL);
+    list->head = calloc(1, sizeof(skiplist_node_t) +
+            SKIPLIST_MAX_LEVEL * sizeof(skiplist_node_t*));
+    return list;
+}
+
+static int random_height(void) {
+    static __thread unsigned int seed;
+    unsigned int x = seed;
+
+    if (x == 0) x = (unsigned int) (uintptr_t) &seed | 1;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    seed = x;
+
+    return __builtin_ctz(x | (1U << (SKIPLIST_MAX_LEVEL - 1))) + 1;
+}
+
+// fills preds with the last nodes whose key is less than key
+static skiplist_node_t *skiplist_find(skiplist_t *list, unsigned long key,
+        skiplist_node_t **preds) {
+    skiplist_node_t *pred = list->head;
+    int level;
+
+    for (level = SKIPLIST_MAX_LEVEL - 1; level >= 0; level--) {
+        while (pred->next[level] != NULL && pred->next[level]->key < key) {
+            pred = pred->next[level];
+        }
+        preds[level] = pred;
+    }
+
+    return pred->next[0];
+}
+
+static int skiplist_put(skiplist_t *list, unsigned long key, void *value) {
+    skiplist_node_t *preds[SKIPLIST_MAX_LEVEL];
+    int level;
+
+    pthread_mutex_lock(&list->lock);
+    skiplist_node_t *node = skiplist_find(list, key, preds);
+
+    if (node != NULL && node->key == key) {
+        node->value = value;
+        pthread_mutex_unlock(&list->lock);
+        return 0;
+    }
+
+    int height = random_height();
+
+    node = malloc(sizeof(skiplist_node_t) +
+            height * sizeof(skiplist_node_t*));
+    if (node != NULL) {
+        node->key = key;
+        node->value = value;
+        for (level = 0; level < height; level++) {
+            node->next[level] = preds[level]->next[level];
+            preds[level]->next[level] = node;
+        }
+    }
+    pthread_mutex_unlock(&list->lock);
+
+    return node == NULL ? -1 : 0;
+}
+
+static void *skiplist_get(skiplist_t *list, unsigned long key) {
+    skiplist_node_t *preds[SKIPLIST_MAX_LEVEL];
+    void *value = NULL;
+
+    pthread_mutex_lock(&list->lock);
+    skiplist_node_t *node = skiplist_find(list, key, preds);
+
+    if (node != NULL && node->key == key) value = node->value;
+    pthread_mutex_unlock(&list->lock);
+
+    return value;
+}
+
+static void *skiplist_remove(skiplist_t *list, unsigned long key) {
+    skiplist_node_t *preds[SKIPLIST_MAX_LEVEL];
+    int level;
+
+    pthread_mutex_lock(&list->lock);
+    skiplist_node_t *node = skiplist_find(list, key, preds);
+
+    if (node == NULL || node->key != key) {
+        pthread_mutex_unlock(&list->lock);
+        return NULL;
+    }
+
+    for (level = 0; level < SKIPLIST_MAX_LEVEL; level++) {
+        if (preds[level]->next[level] != node) break;
+        preds[level]->next[level] = node->next[level];
+    }
+    pthread_mutex_unlock(&list->lock);
+
+    void *value = node->value;
+    free(node);
+
+    return value;
+}
+
+#define QUIESCENT()
+
+#endif /* BENCH_USES_LIBSCM */
+
+static queue_t *queue;
+static map_t *map;
+static skiplist_t *skiplist;
+
+static pthread_barrier_t start_barrier;
+
+// values must not be NULL
+#define VALUE(_key) ((void*) ((_key) + 1))
+
+static inline unsigned long next_random(unsigned long *state) {
+    //xorshift64
+    unsigned long x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+
+    return x;
+}
+
+typedef enum { QUEUE, MAP, SKIPLIST } container_t;
+
+static const char *container_names[] = { "queue", "map", "skiplist" };
+
+typedef struct thread_arguments {
+    long id;
+    container_t container;
+} thread_arguments_t;
+
+static void *run_thread(void *argument) {
+    thread_arguments_t *arguments = argument;
+    unsigned long state = 0x9E3779B97F4A7C15UL * (arguments->id + 1);
+    unsigned long i;
+
+    pthread_barrier_wait(&start_barrier);
+
+    for (i = 0; i < operations_per_thread; i++) {
+        unsigned long random = next_random(&state);
+        unsigned long key = (random >> 16) % number_of_keys;
+        bool update = random % 100 < update_percentage;
+
+        switch (arguments->container) {
+            case QUEUE:
+                queue_enqueue(queue, VALUE(i));
+                queue_dequeue(queue);
+                break;
+            case MAP:
+                if (!update) {
+                    map_get(map, key);
+                } else if (random & 0x100) {
+                    map_put(map, key, VALUE(key));
+                } else {
+                    map_remove(map, key);
+                }
+                break;
+            case SKIPLIST:
+                if (!update) {
+                    skiplist_get(skiplist, key);
+                } else if (random & 0x100) {
+                    skiplist_put(skiplist, key, VALUE(key));
+                } else {
+                    skiplist_remove(skiplist, key);
+                }
+                break;
+        }
+
+        if (i % QUIESCENT_INTERVAL == QUIESCENT_INTERVAL - 1) QUIESCENT();
+    }
+
+    return NULL;
+}
+
+static void run(container_t container) {
+    pthread_t threads[number_of_threads];
+    thread_arguments_t arguments[number_of_threads];
+    unsigned long i;
+
+    pthread_barrier_init(&start_barrier, NULL, number_of_threads + 1);
+
+    for (i = 0; i < number_of_threads; i++) {
+        arguments[i].id = i;
+        arguments[i].container = container;
+        if (pthread_create(&threads[i], NULL, run_thread, &arguments[i])) {
+            fprintf(stderr, "pthread_create failed\n");
+            exit(-1);
+        }
+    }
+
+    uint64_t start = bench_nsec();
+    pthread_barrier_wait(&start_barrier);
+
+    for (i = 0; i < number_of_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    uint64_t duration = bench_nsec() - start;
+
+    pthread_barrier_destroy(&start_barrier);
+
+    printf("container %s ops/s %.0f\n", container_names[container],
+            (double) number_of_threads * operations_per_thread * 1e9 /
+            duration);
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-t threads] [-o operations] [-k keys] "
+            "[-u percent]\n", program);
+    exit(-1);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    unsigned long key;
+
+    while ((opt = getopt(argc, argv, "t:o:k:u:")) != -1) {
+        switch (opt) {
+            case 't':
+                number_of_threads = bench_parse_ul("-t", optarg);
+                break;
+            case 'o':
+                operations_per_thread = bench_parse_ul("-o", optarg);
+                break;
+            case 'k':
+                number_of_keys = bench_parse_ul("-k", optarg);
+                break;
+            case 'u':
+                update_percentage = bench_parse_ul("-u", optarg);
+                if (update_percentage > 100) usage(argv[0]);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    queue = queue_create();
+    map = map_create();
+    skiplist = skiplist_create();
+
+    for (key = 0; key < number_of_keys; key += 2) {
+        map_put(map, key, VALUE(key));
+        skiplist_put(skiplist, key, VALUE(key));
+    }
+
+#ifdef BENCH_USES_LIBSCM
+    //the main thread does not take part in the global time while it waits
+    scm_block_thread();
+#endif
+
+    printf("mode %s threads %lu update %lu%%\n", BENCH_MODE,
+            number_of_threads, update_percentage);
+
+    run(QUEUE);
+    run(MAP);
+    run(SKIPLIST);
+
+    return 0;
+}
@@ -0,0 +1,37 @@
+#!/bin/bash
+
+export LD_LIBRARY_PATH=../../dist/
+
+ALLOCATOR=( MALLOC STM )
+
+THREADS=( 1 2 4 8 )
+UPDATES=( 10 50 )
+OPERATIONS=1000000
+
+cd ../../; make libscm > bench/containers/buildlog.txt; cd -;
+if ! test -f ../../dist/libscm.so; then
+	echo "Build of libscm.so failed";
+	exit
+fi
+
+make clean > /dev/null
+make BENCH_OPTION="$BENCH_OPTION" >> buildlog.txt
+
+mkdir -p bench_results;
+
+for u in ${UPDATES[@]}
+do
+	for t in ${THREADS[@]}
+	do
+		for a in ${ALLOCATOR[@]}
+		do
+			if ! test -f dist/containers${a}; then
+				echo "Build of containers${a} failed";
+				exit
+			fi
+			echo "Started measurement of $a with $t threads and $u% updates";
+			./dist/containers$a -t $t -o $OPERATIONS -u $u > bench_results/containers_${a}_${t}_${u}.dat;
+			sed -n 's/^container //p' bench_results/containers_${a}_${t}_${u}.dat;
+		done
+	done
+done
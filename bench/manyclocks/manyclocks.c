@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+/*
+ * Many-clock stress benchmark.
+ *
+ * Registers as many thread-local clocks as libscm provides (or -k clocks)
+ * and runs rounds in which every clock gets fresh objects that are
+ * refreshed on several clocks at once. A region per round is refreshed on
+ * several clocks as well. At the end of a round every clock is ticked and
+ * one clock is unregistered and registered again, so the zombie buffers
+ * left behind are cleaned up incrementally by the round robin of
+ * scm_tick_clock.
+ *
+ * Finally the zombie cleanup latency is measured: objects are refreshed on
+ * a clock that is then unregistered, and the base clock is ticked until
+ * all of them are reclaimed.
+ *
+ * The benchmark reports:
+ *
+ *  clocks_available      clocks returned by scm_register_clock before -1
+ *  root_kb               heap memory of the descriptor root of a thread,
+ *                        which grows with SCM_MAX_CLOCKS
+ *  descriptor_kb         heap memory of the descriptors of one round
+ *  register_cycles       scm_register_clock
+ *  unregister_cycles     scm_unregister_clock
+ *  refresh_cycles        scm_refresh_with_clock
+ *  tick_cycles           scm_tick_clock
+ *  collect_cycles        scm_collect at the end of a round
+ *  zombie_cleanup_ticks  base clock ticks until a zombie buffer is empty
+ *
+ * Options:
+ *  -k clocks       clocks to use (default: all available)
+ *  -m clocks       clocks every object is refreshed on (default 2)
+ *  -o objects      objects allocated per clock and round (default 256)
+ *  -r rounds       number of rounds (default 1000)
+ *  -e extension    expiration extension of the zombie objects (default 1)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <malloc.h>
+
+#include "bench.h"
+
+// upper bound of base clock ticks waited for a zombie buffer
+#define ZOMBIE_TICK_LIMIT 100000
+
+static unsigned long clocks_to_use = 0;
+static unsigned long clocks_per_object = 2;
+static unsigned long objects_per_clock = 256;
+static unsigned long number_of_rounds = 1000;
+static unsigned long zombie_extension = 1;
+
+static int count_finalizer_id;
+static unsigned long objects_reclaimed = 0;
+
+static int count_finalizer(void *ptr) {
+    objects_reclaimed++;
+    return 0;
+}
+
+typedef struct op_timer op_timer_t;
+
+struct op_timer {
+    uint64_t cycles;
+    unsigned long operations;
+};
+
+#define TIMER_START uint64_t _timer_start = bench_cycles();
+#define TIMER_STOP(_timer, _operations) \
+    (_timer).cycles += bench_cycles() - _timer_start; \
+    (_timer).operations += _operations;
+
+static void report(const char *name, op_timer_t *timer) {
+    printf("%s %.1f\n", name, timer->operations == 0 ? 0.0 :
+            (double) timer->cycles / timer->operations);
+}
+
+static size_t heap_in_use(void) {
+    struct mallinfo2 info = mallinfo2();
+
+    return info.uordblks;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-k clocks] [-m clocks per object] "
+            "[-o objects per clock] [-r rounds] [-e extension]\n", program);
+    exit(-1);
+}
+
+int main(int argc, char **argv) {
+    int option;
+    unsigned long round, c, i, k;
+    int clocks[SCM_MAX_CLOCKS];
+    unsigned long number_of_clocks = 0;
+
+    while ((option = getopt(argc, argv, "k:m:o:r:e:")) != -1) {
+        switch (option) {
+            case 'k':
+                clocks_to_use = bench_parse_ul("-k", optarg);
+                break;
+            case 'm':
+                clocks_per_object = bench_parse_ul("-m", optarg);
+                break;
+            case 'o':
+                objects_per_clock = bench_parse_ul("-o", optarg);
+                break;
+            case 'r':
+                number_of_rounds = bench_parse_ul("-r", optarg);
+                break;
+            case 'e':
+                zombie_extension = bench_parse_ul("-e", optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    if (zombie_extension > SCM_MAX_EXPIRATION_EXTENSION) {
+        fprintf(stderr, "Extension must not exceed %d\n",
+                SCM_MAX_EXPIRATION_EXTENSION);
+        exit(-1);
+    }
+
+    op_timer_t register_timer = { 0, 0 };
+    op_timer_t unregister_timer = { 0, 0 };
+    op_timer_t refresh_timer = { 0, 0 };
+    op_timer_t tick_timer = { 0, 0 };
+    op_timer_t collect_timer = { 0, 0 };
+
+    count_finalizer_id = scm_register_finalizer(count_finalizer);
+
+    // the first scm_register_clock creates the descriptor root of the thread,
+    // registering clocks does not allocate memory
+    size_t heap = heap_in_use();
+
+    // clocks (and their descriptor buffers) are limited by SCM_MAX_CLOCKS,
+    // the bound protects clocks if libscm was built with a larger limit
+    while (number_of_clocks < SCM_MAX_CLOCKS) {
+        TIMER_START
+        int clock = scm_register_clock();
+        TIMER_STOP(register_timer, 1)
+
+        if (clock < 0) break;
+
+        clocks[number_of_clocks++] = clock;
+    }
+    const unsigned long clocks_available = number_of_clocks;
+    const size_t root_bytes = heap_in_use() - heap;
+
+    if (clocks_to_use != 0 && clocks_to_use < number_of_clocks) {
+        for (c = clocks_to_use; c < number_of_clocks; c++) {
+            scm_unregister_clock(clocks[c]);
+        }
+        number_of_clocks = clocks_to_use;
+    }
+    if (number_of_clocks == 0) {
+        fprintf(stderr, "libscm provides no clocks, "
+                "check SCM_MAX_CLOCKS\n");
+        exit(-1);
+    }
+    if (clocks_per_object > number_of_clocks) {
+        clocks_per_object = number_of_clocks;
+    }
+
+    void **objects = malloc(number_of_clocks * objects_per_clock
+            * sizeof(void*));
+    size_t descriptor_bytes = 0;
+
+    for (round = 0; round < number_of_rounds; round++) {
+        int region = scm_create_region();
+
+        for (c = 0; c < number_of_clocks; c++) {
+            for (i = 0; i < objects_per_clock; i++) {
+                objects[c * objects_per_clock + i] =
+                    scm_malloc(32 + (i % 8) * 16);
+            }
+        }
+        if (region >= 0) {
+            for (i = 0; i < objects_per_clock; i++) {
+                scm_malloc_in_region(32 + (i % 8) * 16, region);
+            }
+        }
+
+        heap = heap_in_use();
+
+        // every object is refreshed on clocks_per_object consecutive clocks
+        for (c = 0; c < number_of_clocks; c++) {
+            for (i = 0; i < objects_per_clock; i++) {
+                void *ptr = objects[c * objects_per_clock + i];
+
+                TIMER_START
+                for (k = 0; k < clocks_per_object; k++) {
+                    scm_refresh_with_clock(ptr, 0,
+                            clocks[(c + k) % number_of_clocks]);
+                }
+                TIMER_STOP(refresh_timer, clocks_per_object)
+            }
+        }
+        if (region >= 0) {
+            for (k = 0; k < clocks_per_object; k++) {
+                scm_refresh_region_with_clock(region, 0, clocks[k]);
+            }
+            scm_unregister_region(region);
+        }
+
+        if (heap_in_use() > heap && heap_in_use() - heap > descriptor_bytes) {
+            descriptor_bytes = heap_in_use() - heap;
+        }
+
+        for (c = 0; c < number_of_clocks; c++) {
+            TIMER_START
+            scm_tick_clock(clocks[c]);
+            TIMER_STOP(tick_timer, 1)
+        }
+
+        TIMER_START
+        scm_collect();
+        TIMER_STOP(collect_timer, 1)
+
+        // replace one clock, its buffer becomes a zombie until cleaned up
+        c = round % number_of_clocks;
+        {
+            TIMER_START
+            scm_unregister_clock(clocks[c]);
+            TIMER_STOP(unregister_timer, 1)
+        }
+        {
+            TIMER_START
+            clocks[c] = scm_register_clock();
+            TIMER_STOP(register_timer, 1)
+        }
+        if (clocks[c] < 0) {
+            fprintf(stderr, "Failed to register clock in round %lu\n", round);
+            exit(-1);
+        }
+    }
+
+    // zombie cleanup latency of the last clock
+    const int victim = clocks[number_of_clocks - 1];
+    unsigned long ticks = 0;
+
+    scm_collect();
+    objects_reclaimed = 0;
+
+    for (i = 0; i < objects_per_clock; i++) {
+        void *ptr = scm_malloc(64);
+        scm_set_finalizer(ptr, count_finalizer_id);
+        scm_refresh_with_clock(ptr, zombie_extension, victim);
+    }
+    scm_unregister_clock(victim);
+
+    while (objects_reclaimed < objects_per_clock
+            && ticks < ZOMBIE_TICK_LIMIT) {
+        scm_tick();
+        scm_collect();
+        ticks++;
+    }
+
+    printf("mode %s clocks %lu clocks_per_object %lu objects %lu "
+            "rounds %lu\n", BENCH_MODE, number_of_clocks, clocks_per_object,
+            objects_per_clock, number_of_rounds);
+    printf("clocks_available %lu\n", clocks_available);
+    printf("root_kb %zu\n", root_bytes / 1024);
+    printf("descriptor_kb %zu\n", descriptor_bytes / 1024);
+    report("register_cycles", &register_timer);
+    report("unregister_cycles", &unregister_timer);
+    report("refresh_cycles", &refresh_timer);
+    report("tick_cycles", &tick_timer);
+    report("collect_cycles", &collect_timer);
+    if (objects_reclaimed < objects_per_clock) {
+        printf("zombie_cleanup_ticks never (%lu of %lu reclaimed)\n",
+                objects_reclaimed, objects_per_clock);
+    } else {
+        printf("zombie_cleanup_ticks %lu\n", ticks);
+    }
+    printf("rss_kb %ld\n", bench_rss_kb());
+
+    free(objects);
+
+    return 0;
+}
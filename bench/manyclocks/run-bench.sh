@@ -0,0 +1,38 @@
+#!/bin/bash
+
+# Rebuild libscm with a different number of clocks, e.g.
+#   SCM="-DSCM_MAX_CLOCKS=32" ./run-bench.sh
+# to size SCM_MAX_CLOCKS. SCM is passed to the benchmark as well, which
+# sizes its clock array with SCM_MAX_CLOCKS.
+
+export LD_LIBRARY_PATH=../../dist/
+
+CLOCKS=( 1 2 4 8 )
+CLOCKS_PER_OBJECT=( 1 2 4 )
+OBJECTS=256
+ROUNDS=1000
+
+cd ../../; make clean > /dev/null; make SCM="$SCM" > bench/manyclocks/buildlog.txt; cd -;
+if ! test -f ../../dist/libscm.so; then
+	echo "Build of libscm.so failed";
+	exit
+fi
+
+make clean > /dev/null
+make BENCH_OPTION="$BENCH_OPTION $SCM" >> buildlog.txt
+if ! test -f dist/manyclocks; then
+	echo "Build of manyclocks failed";
+	exit
+fi
+
+mkdir -p bench_results;
+
+for k in ${CLOCKS[@]}
+do
+	for m in ${CLOCKS_PER_OBJECT[@]}
+	do
+		echo "Started measurement with $k clocks and $m clocks per object";
+		./dist/manyclocks -k $k -m $m -o $OBJECTS -r $ROUNDS > bench_results/manyclocks_${k}_${m}.dat;
+		sed -n 's/\(clocks_available\|descriptor_kb\|tick_cycles\|zombie_cleanup_ticks\) /\1: /p' bench_results/manyclocks_${k}_${m}.dat;
+	done
+done
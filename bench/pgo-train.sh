@@ -0,0 +1,42 @@
+#!/bin/bash
+
+# Training workload for profile-guided optimization (make pgo).
+# Runs sh6bench and the benchmark suite against the instrumented
+# dist/libscm.so with moderate sizes so that the profile covers the
+# object, region and multi-clock paths of libscm.
+
+export LD_LIBRARY_PATH=$(cd ../dist && pwd)
+
+if ! test -f ../dist/libscm.so; then
+	echo "Build of libscm.so failed";
+	exit 1
+fi
+
+for b in sh6bench server threadchurn manyclocks
+do
+	(cd $b && make clean > /dev/null && make > /dev/null) || exit 1
+done
+# the fast paths of phasesSTM_FAST need the static library
+(cd phases && make clean > /dev/null \
+	&& make dist/phasesSTM dist/phasesSTR dist/phasesSTRMC > /dev/null) || exit 1
+
+for a in STM STR STRMC
+do
+	echo "Training with sh6bench${a}";
+	# sh6bench has a void main, its exit status is undefined
+	./sh6bench/dist/sh6bench$a < /dev/null > /dev/null
+	echo "Training with server${a}";
+	./server/dist/server$a -t 2 -n 20000 > /dev/null || exit 1
+	echo "Training with threadchurn${a}";
+	./threadchurn/dist/threadchurn$a -n 2000 > /dev/null || exit 1
+	echo "Training with phases${a}";
+	./phases/dist/phases$a -r 20 > /dev/null || exit 1
+done
+
+echo "Training with manyclocks";
+./manyclocks/dist/manyclocks -r 200 > /dev/null || exit 1
+
+for b in sh6bench server threadchurn phases manyclocks
+do
+	(cd $b && make clean > /dev/null)
+done
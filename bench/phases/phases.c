@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+/*
+ * Phase benchmark.
+ *
+ * Runs the allocator operations of a short-term memory round in separate
+ * phases so that their costs can be attributed to the code paths of libscm:
+ *
+ *  allocate   scm_malloc, scm_malloc_in_region or malloc
+ *  refresh    scm_refresh (insert_descriptor) or scm_refresh_region
+ *  tick       scm_tick or scm_tick_clock (expire_buffer)
+ *  collect    scm_collect (eager_collect) or free
+ *
+ * Every phase reports cycles per operation. Built with -DPERF_COUNTERS the
+ * phases are also wrapped with hardware (or software) counters, see
+ * perfcounters.h.
+ *
+ * phasesSTM_FAST uses the unchecked calls of libscm_fast.h and is linked
+ * against the static libscm with link-time optimization.
+ *
+ * Options:
+ *  -n objects   objects allocated per round (default 10000)
+ *  -r rounds    number of rounds (default 100)
+ *  -s size      object size in bytes (default 64)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "perfcounters.h"
+
+#ifdef SCM_FAST
+#include "libscm_fast.h"
+#define REFRESH(_ptr, _extension) scm_refresh_fast(_ptr, _extension, 0)
+#define TICK() scm_tick_fast(0)
+#else
+#define REFRESH(_ptr, _extension) scm_refresh(_ptr, _extension)
+#define TICK() scm_tick()
+#endif
+
+static unsigned long objects_per_round = 10000;
+static unsigned long number_of_rounds = 100;
+static unsigned long object_size = 64;
+
+typedef struct phase_timer phase_timer_t;
+
+struct phase_timer {
+    const char *name;
+    uint64_t cycles;
+    unsigned long operations;
+};
+
+#define PHASE_START(_timer, _perf) \
+    PERF_PHASE_START(_perf); \
+    uint64_t _start_##_timer = bench_cycles();
+#define PHASE_STOP(_timer, _perf, _operations) \
+    _timer.cycles += bench_cycles() - _start_##_timer; \
+    _timer.operations += _operations; \
+    PERF_PHASE_STOP(_perf, _operations);
+
+static void report(phase_timer_t *timer) {
+    if (timer->operations == 0) return;
+
+    printf("phase %s cycles %.1f\n", timer->name,
+            (double) timer->cycles / timer->operations);
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-n objects] [-r rounds] [-s size]\n",
+            program);
+    exit(-1);
+}
+
+int main(int argc, char **argv) {
+    int option;
+    unsigned long round, i;
+
+    while ((option = getopt(argc, argv, "n:r:s:")) != -1) {
+        switch (option) {
+            case 'n':
+                objects_per_round = bench_parse_ul("-n", optarg);
+                break;
+            case 'r':
+                number_of_rounds = bench_parse_ul("-r", optarg);
+                break;
+            case 's':
+                object_size = bench_parse_ul("-s", optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    void **objects = malloc(objects_per_round * sizeof(void*));
+
+    phase_timer_t allocate = { "allocate", 0, 0 };
+    phase_timer_t refresh = { "refresh", 0, 0 };
+    phase_timer_t tick = { "tick", 0, 0 };
+    phase_timer_t collect = { "collect", 0, 0 };
+
+    PERF_PHASE(allocate_perf)
+    PERF_PHASE(refresh_perf)
+    PERF_PHASE(tick_perf)
+    PERF_PHASE(collect_perf)
+
+    PERF_PHASE_INIT(allocate_perf, "allocate");
+    PERF_PHASE_INIT(refresh_perf, "refresh");
+    PERF_PHASE_INIT(tick_perf, "tick");
+    PERF_PHASE_INIT(collect_perf, "collect");
+
+#ifdef STRMC_MALLOC
+    const int clock = scm_register_clock();
+#endif
+#ifdef SCM_FAST
+    // the unchecked calls require a thread that is registered in libscm
+    scm_unregister_clock(scm_register_clock());
+#endif
+
+    for (round = 0; round < number_of_rounds; round++) {
+#if defined STR_MALLOC || defined STRMC_MALLOC
+        const int region = scm_create_region();
+#endif
+
+        PHASE_START(allocate, allocate_perf)
+        for (i = 0; i < objects_per_round; i++) {
+#if defined STM_MALLOC
+            objects[i] = scm_malloc(object_size);
+#elif defined STR_MALLOC || defined STRMC_MALLOC
+            objects[i] = scm_malloc_in_region(object_size, region);
+#else
+            objects[i] = malloc(object_size);
+#endif
+        }
+        PHASE_STOP(allocate, allocate_perf, objects_per_round)
+
+#if defined BENCH_USES_LIBSCM
+        PHASE_START(refresh, refresh_perf)
+#if defined STM_MALLOC
+        for (i = 0; i < objects_per_round; i++) {
+            REFRESH(objects[i], 0);
+        }
+        PHASE_STOP(refresh, refresh_perf, objects_per_round)
+#elif defined STR_MALLOC
+        scm_refresh_region(region, 0);
+        PHASE_STOP(refresh, refresh_perf, 1)
+#else
+        scm_refresh_region_with_clock(region, 0, clock);
+        PHASE_STOP(refresh, refresh_perf, 1)
+#endif
+
+#if defined STR_MALLOC || defined STRMC_MALLOC
+        scm_unregister_region(region);
+#endif
+
+        PHASE_START(tick, tick_perf)
+#ifdef STRMC_MALLOC
+        scm_tick_clock(clock);
+#else
+        TICK();
+#endif
+        PHASE_STOP(tick, tick_perf, 1)
+
+        PHASE_START(collect, collect_perf)
+        scm_collect();
+#ifdef STM_MALLOC
+        PHASE_STOP(collect, collect_perf, objects_per_round)
+#else
+        PHASE_STOP(collect, collect_perf, 1)
+#endif
+#else
+        PHASE_START(collect, collect_perf)
+        for (i = 0; i < objects_per_round; i++) {
+            free(objects[i]);
+        }
+        PHASE_STOP(collect, collect_perf, objects_per_round)
+#endif
+    }
+
+#ifdef SCM_FAST
+    printf("fast_paths yes\n");
+#endif
+    printf("mode %s objects %lu rounds %lu size %lu\n", BENCH_MODE,
+            objects_per_round, number_of_rounds, object_size);
+    report(&allocate);
+    report(&refresh);
+    report(&tick);
+    report(&collect);
+    printf("rss_kb %ld\n", bench_rss_kb());
+
+    PERF_PHASE_REPORT(allocate_perf);
+    PERF_PHASE_REPORT(refresh_perf);
+    PERF_PHASE_REPORT(tick_perf);
+    PERF_PHASE_REPORT(collect_perf);
+
+    free(objects);
+
+    return 0;
+}
@@ -0,0 +1,36 @@
+#!/bin/bash
+
+# Set BENCH_OPTION=-DPERF_COUNTERS to include hardware counters per phase.
+
+export LD_LIBRARY_PATH=../../dist/
+
+ALLOCATOR=( MALLOC STM STM_FAST STR STRMC )
+
+SIZES=( 16 64 256 1024 )
+OBJECTS=10000
+ROUNDS=100
+
+cd ../../; make libscm static > bench/phases/buildlog.txt; cd -;
+if ! test -f ../../dist/libscm.so; then
+	echo "Build of libscm.so failed";
+	exit
+fi
+
+make clean > /dev/null
+make BENCH_OPTION="$BENCH_OPTION" >> buildlog.txt
+
+mkdir -p bench_results;
+
+for s in ${SIZES[@]}
+do
+	for a in ${ALLOCATOR[@]}
+	do
+		if ! test -f dist/phases${a}; then
+			echo "Build of phases${a} failed";
+			exit
+		fi
+		echo "Started measurement of $a with object size $s";
+		./dist/phases$a -n $OBJECTS -r $ROUNDS -s $s > bench_results/phases_${a}_${s}.dat;
+		sed -n 's/^\(phase\|perf\) //p' bench_results/phases_${a}_${s}.dat;
+	done
+done
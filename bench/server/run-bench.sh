@@ -0,0 +1,37 @@
+#!/bin/bash
+
+export LD_LIBRARY_PATH=../../dist/
+
+ALLOCATOR=( MALLOC STM STR STRMC )
+
+THREADS=( 1 2 4 8 )
+PAYLOAD=( 256 1024 4096 )
+REQUESTS=100000
+
+cd ../../; make > bench/server/buildlog.txt; cd -;
+if ! test -f ../../dist/libscm.so; then
+	echo "Build of libscm.so failed";
+	exit
+fi
+
+make clean > /dev/null
+make BENCH_OPTION="$BENCH_OPTION" >> buildlog.txt
+
+mkdir -p bench_results;
+
+for p in ${PAYLOAD[@]}
+do
+	for t in ${THREADS[@]}
+	do
+		for a in ${ALLOCATOR[@]}
+		do
+			if ! test -f dist/server${a}; then
+				echo "Build of server${a} failed";
+				exit
+			fi
+			echo "Started measurement of $a with $t threads and payload $p";
+			./dist/server$a -t $t -n $REQUESTS -p $p > bench_results/server_${a}_${t}_${p}.dat;
+			sed -n 's/\(requests_per_second\|allocator_cycles_per_request\|rss_kb\) /\1: /p' bench_results/server_${a}_${t}_${p}.dat;
+		done
+	done
+done
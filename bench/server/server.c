@@ -0,0 +1,484 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+/*
+ * Request-lifecycle server workload.
+ *
+ * Every worker thread simulates a server that handles connections of
+ * several requests each. A request allocates an input buffer, fills it with
+ * a synthetic "key=value&key=value..." payload, parses the payload into a
+ * list of fields, builds a response from the fields and finishes with the
+ * request boundary (free, tick or region expiration depending on the
+ * allocator). Each connection keeps a session object alive across its
+ * requests.
+ *
+ * Options:
+ *  -t threads       number of concurrent worker threads (default 1)
+ *  -n requests      requests handled by each worker (default 100000)
+ *  -p payload       payload size of a request in bytes (default 1024)
+ *  -c requests      requests per connection/session (default 16)
+ *
+ * The time spent inside allocator calls (allocation, refresh, free, tick) is
+ * measured with the cycle counter and reported per request. Built with
+ * -DPERF_COUNTERS the request loop of every worker is also wrapped with
+ * hardware counters, see perfcounters.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "bench.h"
+#include "perfcounters.h"
+
+typedef struct field field_t;
+
+struct field {
+    char *key;
+    char *value;
+    field_t *next;
+};
+
+typedef struct session session_t;
+
+struct session {
+    unsigned long id;
+    unsigned long requests;
+    unsigned long checksum;
+};
+
+typedef struct worker worker_t;
+
+struct worker {
+    pthread_t thread;
+    unsigned long id;
+
+    unsigned long requests;
+    unsigned long allocations;
+    unsigned long checksum;
+
+    uint64_t allocator_cycles;
+    uint64_t total_cycles;
+
+    PERF_PHASE(request_perf)
+
+#ifdef MALLOC_ONLY
+    // objects allocated during the current request, freed at its end
+    void **live;
+    unsigned long number_of_live;
+    unsigned long live_capacity;
+#endif
+
+#ifdef STRMC_MALLOC
+    int request_clock;
+    int session_clock;
+#endif
+
+    // region of the current request
+    int region;
+};
+
+static unsigned long number_of_threads = 1;
+static unsigned long requests_per_thread = 100000;
+static unsigned long payload_size = 1024;
+static unsigned long requests_per_connection = 16;
+
+#define ALLOCATOR_START uint64_t _alloc_start = bench_cycles();
+#define ALLOCATOR_STOP(_worker) \
+    (_worker)->allocator_cycles += bench_cycles() - _alloc_start;
+
+/*
+ * Allocates short-lived request memory with the allocator under test.
+ */
+static void *request_alloc(worker_t *worker, size_t size) {
+    void *ptr;
+
+    ALLOCATOR_START
+#if defined STM_MALLOC
+    ptr = scm_malloc(size);
+    scm_refresh(ptr, 0);
+#elif defined STR_MALLOC || defined STRMC_MALLOC
+    ptr = scm_malloc_in_region(size, worker->region);
+
+    if (ptr == NULL) {
+        // too large for a region page, fall back to a short-term object
+        ptr = scm_malloc(size);
+#ifdef STR_MALLOC
+        scm_refresh(ptr, 0);
+#else
+        scm_refresh_with_clock(ptr, 0, worker->request_clock);
+#endif
+    }
+#else
+    ptr = malloc(size);
+
+    if (ptr != NULL) {
+        if (worker->number_of_live == worker->live_capacity) {
+            worker->live_capacity *= 2;
+            worker->live = realloc(worker->live,
+                    worker->live_capacity * sizeof(void*));
+        }
+        worker->live[worker->number_of_live++] = ptr;
+    }
+#endif
+    ALLOCATOR_STOP(worker)
+
+    if (ptr == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(-1);
+    }
+
+    worker->allocations++;
+
+    return ptr;
+}
+
+static void request_begin(worker_t *worker) {
+#if defined STR_MALLOC || defined STRMC_MALLOC
+    ALLOCATOR_START
+    worker->region = scm_create_region();
+#ifdef STR_MALLOC
+    scm_refresh_region(worker->region, 0);
+#else
+    scm_refresh_region_with_clock(worker->region, 0, worker->request_clock);
+#endif
+    ALLOCATOR_STOP(worker)
+
+    if (worker->region < 0) {
+        fprintf(stderr, "Out of regions\n");
+        exit(-1);
+    }
+#endif
+}
+
+static void request_end(worker_t *worker) {
+    ALLOCATOR_START
+#if defined STM_MALLOC
+    scm_tick();
+#elif defined STR_MALLOC
+    scm_unregister_region(worker->region);
+    scm_tick();
+#elif defined STRMC_MALLOC
+    scm_unregister_region(worker->region);
+    scm_tick_clock(worker->request_clock);
+#else
+    while (worker->number_of_live > 0) {
+        free(worker->live[--worker->number_of_live]);
+    }
+#endif
+    ALLOCATOR_STOP(worker)
+}
+
+static session_t *session_open(worker_t *worker, unsigned long id) {
+    session_t *session;
+
+    ALLOCATOR_START
+#if defined BENCH_USES_LIBSCM
+    session = scm_malloc(sizeof(session_t));
+#ifdef STRMC_MALLOC
+    scm_refresh_with_clock(session, 0, worker->session_clock);
+#endif
+#else
+    session = malloc(sizeof(session_t));
+#endif
+    ALLOCATOR_STOP(worker)
+
+    session->id = id;
+    session->requests = 0;
+    session->checksum = 0;
+
+    worker->allocations++;
+
+    return session;
+}
+
+/*
+ * A session is used by every request of its connection.
+ */
+static void session_touch(worker_t *worker, session_t *session) {
+#if defined STM_MALLOC || defined STR_MALLOC
+    ALLOCATOR_START
+    scm_refresh(session, 1);
+    ALLOCATOR_STOP(worker)
+#endif
+    session->requests++;
+}
+
+static void session_close(worker_t *worker, session_t *session) {
+    worker->checksum += session->checksum + session->requests;
+
+    ALLOCATOR_START
+#if defined STRMC_MALLOC
+    scm_tick_clock(worker->session_clock);
+#elif defined MALLOC_ONLY
+    free(session);
+#endif
+    ALLOCATOR_STOP(worker)
+}
+
+/*
+ * Writes a synthetic url-encoded payload of exactly length bytes.
+ */
+static void generate_payload(char *buffer, size_t length,
+        unsigned long request) {
+    size_t position = 0;
+    unsigned long field = 0;
+
+    while (position < length) {
+        int written = snprintf(buffer + position, length - position + 1,
+                "%sk%lu=v%lu", field == 0 ? "" : "&", field,
+                request * 31 + field);
+
+        if (written < 0) break;
+
+        position += written;
+        field++;
+    }
+    buffer[length] = '\0';
+}
+
+static char *copy_token(worker_t *worker, const char *start, size_t length) {
+    char *token = request_alloc(worker, length + 1);
+
+    memcpy(token, start, length);
+    token[length] = '\0';
+
+    return token;
+}
+
+/*
+ * Parses key=value pairs separated by '&' into a list of fields.
+ */
+static field_t *parse_payload(worker_t *worker, const char *payload,
+        unsigned long *number_of_fields) {
+    field_t *first = NULL;
+    field_t *last = NULL;
+    const char *position = payload;
+
+    *number_of_fields = 0;
+
+    while (*position != '\0') {
+        const char *end = strchr(position, '&');
+        const char *separator = strchr(position, '=');
+
+        if (end == NULL) end = position + strlen(position);
+        if (separator == NULL || separator > end) separator = end;
+
+        field_t *field = request_alloc(worker, sizeof(field_t));
+        field->key = copy_token(worker, position, separator - position);
+        field->value = copy_token(worker, separator == end ?
+                end : separator + 1,
+                separator == end ? 0 : end - separator - 1);
+        field->next = NULL;
+
+        if (last == NULL) {
+            first = field;
+        } else {
+            last->next = field;
+        }
+        last = field;
+        (*number_of_fields)++;
+
+        position = *end == '&' ? end + 1 : end;
+    }
+
+    return first;
+}
+
+/*
+ * Builds a "key: VALUE\r\n" response from the parsed fields.
+ */
+static char *build_response(worker_t *worker, field_t *fields) {
+    size_t length = 1;
+    field_t *field;
+
+    for (field = fields; field != NULL; field = field->next) {
+        length += strlen(field->key) + strlen(field->value) + 4;
+    }
+
+    char *response = request_alloc(worker, length);
+    char *position = response;
+
+    for (field = fields; field != NULL; field = field->next) {
+        size_t key_length = strlen(field->key);
+        size_t value_length = strlen(field->value);
+        size_t i;
+
+        memcpy(position, field->key, key_length);
+        position += key_length;
+        *position++ = ':';
+        *position++ = ' ';
+        for (i = 0; i < value_length; i++) {
+            char c = field->value[i];
+            *position++ = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+        }
+        *position++ = '\r';
+        *position++ = '\n';
+    }
+    *position = '\0';
+
+    return response;
+}
+
+static void handle_request(worker_t *worker, session_t *session,
+        unsigned long request) {
+    unsigned long number_of_fields;
+    unsigned long checksum = 0;
+
+    request_begin(worker);
+
+    session_touch(worker, session);
+
+    char *payload = request_alloc(worker, payload_size + 1);
+    generate_payload(payload, payload_size, request);
+
+    field_t *fields = parse_payload(worker, payload, &number_of_fields);
+    char *response = build_response(worker, fields);
+
+    while (*response != '\0') {
+        checksum = checksum * 33 + (unsigned char) *response++;
+    }
+    session->checksum += checksum + number_of_fields;
+
+    request_end(worker);
+}
+
+static void *run_worker(void *arg) {
+    worker_t *worker = (worker_t*) arg;
+    session_t *session = NULL;
+    unsigned long request;
+
+#ifdef MALLOC_ONLY
+    worker->live_capacity = 1024;
+    worker->live = malloc(worker->live_capacity * sizeof(void*));
+#endif
+
+#ifdef STRMC_MALLOC
+    worker->request_clock = scm_register_clock();
+    worker->session_clock = scm_register_clock();
+
+    if (worker->request_clock < 0 || worker->session_clock < 0) {
+        fprintf(stderr, "Out of clocks\n");
+        exit(-1);
+    }
+#endif
+
+    PERF_PHASE_INIT(worker->request_perf, "request");
+    PERF_PHASE_START(worker->request_perf);
+
+    uint64_t start = bench_cycles();
+
+    for (request = 0; request < requests_per_thread; request++) {
+        if (request % requests_per_connection == 0) {
+            if (session != NULL) session_close(worker, session);
+
+            session = session_open(worker,
+                    worker->id * requests_per_thread + request);
+        }
+
+        handle_request(worker, session, request);
+
+        worker->requests++;
+    }
+    if (session != NULL) session_close(worker, session);
+
+    worker->total_cycles = bench_cycles() - start;
+
+    PERF_PHASE_STOP(worker->request_perf, requests_per_thread);
+
+#ifdef MALLOC_ONLY
+    free(worker->live);
+#endif
+
+    return NULL;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-t threads] [-n requests] [-p payload] "
+            "[-c requests per connection]\n", program);
+    exit(-1);
+}
+
+int main(int argc, char **argv) {
+    int option;
+    unsigned long i;
+
+    while ((option = getopt(argc, argv, "t:n:p:c:")) != -1) {
+        switch (option) {
+            case 't':
+                number_of_threads = bench_parse_ul("-t", optarg);
+                break;
+            case 'n':
+                requests_per_thread = bench_parse_ul("-n", optarg);
+                break;
+            case 'p':
+                payload_size = bench_parse_ul("-p", optarg);
+                break;
+            case 'c':
+                requests_per_connection = bench_parse_ul("-c", optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+    worker_t *workers = calloc(number_of_threads, sizeof(worker_t));
+
+    uint64_t start = bench_nsec();
+
+    for (i = 0; i < number_of_threads; i++) {
+        workers[i].id = i;
+        if (pthread_create(&workers[i].thread, NULL, run_worker,
+                &workers[i]) != 0) {
+            fprintf(stderr, "Failed to start thread %lu\n", i);
+            exit(-1);
+        }
+    }
+
+    unsigned long requests = 0;
+    unsigned long allocations = 0;
+    unsigned long checksum = 0;
+    uint64_t allocator_cycles = 0;
+    uint64_t total_cycles = 0;
+
+    PERF_PHASE(request_perf)
+    PERF_PHASE_INIT_TOTAL(request_perf, "request");
+
+    for (i = 0; i < number_of_threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+
+        PERF_PHASE_MERGE(request_perf, workers[i].request_perf);
+
+        requests += workers[i].requests;
+        allocations += workers[i].allocations;
+        checksum += workers[i].checksum;
+        allocator_cycles += workers[i].allocator_cycles;
+        total_cycles += workers[i].total_cycles;
+    }
+
+    double seconds = (bench_nsec() - start) / 1e9;
+
+    printf("mode %s threads %lu payload %lu connection %lu\n", BENCH_MODE,
+            number_of_threads, payload_size, requests_per_connection);
+    printf("requests %lu\n", requests);
+    printf("requests_per_second %.0f\n", requests / seconds);
+    printf("allocations_per_request %.1f\n",
+            (double) allocations / requests);
+    printf("allocator_cycles_per_request %.0f\n",
+            (double) allocator_cycles / requests);
+    printf("cycles_per_request %.0f\n", (double) total_cycles / requests);
+    printf("rss_kb %ld\n", bench_rss_kb());
+    printf("checksum %lu\n", checksum);
+
+    PERF_PHASE_REPORT(request_perf);
+
+    free(workers);
+
+    return 0;
+}
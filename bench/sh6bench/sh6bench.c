@@ -139,6 +139,15 @@ typedef TID ThreadID;
 /*******************************/
 
 #include <malloc.h>
+
+#include "perfcounters.h"
+#ifdef PERF_COUNTERS
+#include <pthread.h>
+/* counters of all doBench threads, merged when the threads finish */
+static perf_phase_t bench_perf;
+static pthread_mutex_t bench_perf_mutex = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
 #ifdef PRINTMEMINFO
        #include <malloc.h>
 #ifndef SYS_MULTI_THREAD
@@ -304,6 +313,8 @@ void main(int argc, char *argv[])
 		exit(-1);
 	}
 
+	PERF_PHASE_INIT_TOTAL(bench_perf, "bench");
+
 	ulCallCount = promptAndRead("call count", ulCallCount, 'u');
 	uMinBlockSize = (unsigned)promptAndRead("min block size",uMinBlockSize,'u');
 	uMaxBlockSize = (unsigned)promptAndRead("max block size",uMaxBlockSize,'u');
@@ -411,6 +422,7 @@ void main(int argc, char *argv[])
 		fclose(fout);
 	
 	printf("Occurred page faults: %d\n", getPagefault() - pf0);
+	PERF_PHASE_REPORT(bench_perf);
 }
 
 void doBench(void *arg)
@@ -443,6 +455,10 @@ void doBench(void *arg)
 
 	uint64_t latency;
 
+	PERF_PHASE(thread_perf)
+	PERF_PHASE_INIT(thread_perf, "bench");
+	PERF_PHASE_START(thread_perf);
+
         UPDATENETMEM(ulCallCount * sizeof(void*));
 	SHOWMEMINFO;
 
@@ -751,6 +767,13 @@ void doBench(void *arg)
 	free(memory);
 	UPDATENETMEM(-(ulCallCount*sizeof(void*)));
 	SHOWMEMINFO;
+
+	PERF_PHASE_STOP(thread_perf, ulCallCount);
+#ifdef PERF_COUNTERS
+	pthread_mutex_lock(&bench_perf_mutex);
+	PERF_PHASE_MERGE(bench_perf, thread_perf);
+	pthread_mutex_unlock(&bench_perf_mutex);
+#endif
 }
 
 unsigned long promptAndRead(char *msg, unsigned long defaultVal, char fmtCh)
@@ -0,0 +1,33 @@
+#!/bin/bash
+
+export LD_LIBRARY_PATH=../../dist/
+
+ALLOCATOR=( MALLOC STM STR STRMC )
+
+WAVE=( 1 4 16 64 )
+THREADS=20000
+
+cd ../../; make > bench/threadchurn/buildlog.txt; cd -;
+if ! test -f ../../dist/libscm.so; then
+	echo "Build of libscm.so failed";
+	exit
+fi
+
+make clean > /dev/null
+make BENCH_OPTION="$BENCH_OPTION" >> buildlog.txt
+
+mkdir -p bench_results;
+
+for w in ${WAVE[@]}
+do
+	for a in ${ALLOCATOR[@]}
+	do
+		if ! test -f dist/threadchurn${a}; then
+			echo "Build of threadchurn${a} failed";
+			exit
+		fi
+		echo "Started measurement of $a with $THREADS threads in waves of $w";
+		./dist/threadchurn$a -n $THREADS -t $w > bench_results/threadchurn_${a}_${w}.dat;
+		sed -n 's/\(threads_per_second\|approx_register_cycles\|approx_unregister_cycles\|approx_process_heap_kb\|objects_reclaimed\) /\1: /p' bench_results/threadchurn_${a}_${w}.dat;
+	done
+done
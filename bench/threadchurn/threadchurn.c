@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+/*
+ * Thread churn benchmark.
+ *
+ * Creates and destroys threads at a high rate, the way connection-per-thread
+ * services do. Threads are started in waves of concurrent threads; each
+ * thread allocates and refreshes a few objects, ticks and terminates.
+ *
+ * The first libscm call of a thread creates its descriptor root
+ * (create_descriptor_root, register_thread), either from scratch or by
+ * reusing the root of a terminated thread. Thread termination runs
+ * unregister_thread, which hands the root back to the pool of terminated
+ * descriptor roots. libscm does not expose these steps, so the benchmark
+ * reports approximations (the approx_ keys):
+ *
+ *  approx_register_cycles    cost of the first allocator calls of a
+ *                            thread, i.e. registration plus the first
+ *                            allocation, region and clock setup
+ *  work_cycles               cost of the remaining allocator calls of a
+ *                            thread
+ *  approx_unregister_cycles  time between the return of a thread and its
+ *                            join, i.e. unregistration plus the thread
+ *                            exit and join
+ *  approx_process_heap_kb    memory in use by the whole process heap after
+ *                            all waves, which includes the terminated
+ *                            descriptor roots and every other allocation
+ *  objects_reclaimed         objects whose memory was reclaimed by libscm
+ *                            (STM)
+ *
+ * Built with -DPERF_COUNTERS the first call and the work of every thread are
+ * also wrapped with hardware counters, see perfcounters.h. Opening the
+ * counters costs several system calls per thread, so the thread rate is
+ * lower in that configuration.
+ *
+ * Options:
+ *  -n threads   total number of threads to create (default 10000)
+ *  -t threads   number of concurrent threads per wave (default 4)
+ *  -o objects   objects allocated by each thread (default 64)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <pthread.h>
+
+#include "bench.h"
+#include "perfcounters.h"
+
+typedef struct churn_thread churn_thread_t;
+
+struct churn_thread {
+    pthread_t thread;
+
+    uint64_t first_call_cycles;
+    uint64_t work_cycles;
+
+    // cycle counter right before the thread function returns
+    uint64_t returned_at;
+
+    PERF_PHASE(first_call_perf)
+    PERF_PHASE(work_perf)
+};
+
+static unsigned long number_of_threads = 10000;
+static unsigned long threads_per_wave = 4;
+static unsigned long objects_per_thread = 64;
+
+#ifdef BENCH_USES_LIBSCM
+static int count_finalizer_id;
+static unsigned long objects_reclaimed = 0;
+
+static int count_finalizer(void *ptr) {
+    __sync_add_and_fetch(&objects_reclaimed, 1);
+    return 0;
+}
+#endif
+
+/*
+ * Allocates one object with the allocator under test. The very first call
+ * of a thread registers the thread in libscm.
+ */
+static void *allocate(unsigned long i, int region, int clock) {
+#if defined STM_MALLOC
+    void *ptr = scm_malloc(32 + (i % 8) * 16);
+    scm_set_finalizer(ptr, count_finalizer_id);
+    scm_refresh(ptr, i % 2);
+#elif defined STR_MALLOC || defined STRMC_MALLOC
+    void *ptr = scm_malloc_in_region(32 + (i % 8) * 16, region);
+#else
+    void *ptr = malloc(32 + (i % 8) * 16);
+#endif
+    return ptr;
+}
+
+static void *run_thread(void *arg) {
+    churn_thread_t *churn = (churn_thread_t*) arg;
+    void *objects[objects_per_thread];
+    unsigned long i;
+    int region = -1;
+    int clock = 0;
+
+    PERF_PHASE_INIT(churn->first_call_perf, "first_call");
+    PERF_PHASE_INIT(churn->work_perf, "work");
+
+    PERF_PHASE_START(churn->first_call_perf);
+    uint64_t start = bench_cycles();
+#if defined STR_MALLOC || defined STRMC_MALLOC
+    region = scm_create_region();
+#ifdef STRMC_MALLOC
+    clock = scm_register_clock();
+    scm_refresh_region_with_clock(region, 1, clock);
+#else
+    scm_refresh_region(region, 1);
+#endif
+#endif
+    objects[0] = allocate(0, region, clock);
+    churn->first_call_cycles = bench_cycles() - start;
+    PERF_PHASE_STOP(churn->first_call_perf, 1);
+
+    PERF_PHASE_START(churn->work_perf);
+    start = bench_cycles();
+    for (i = 1; i < objects_per_thread; i++) {
+        objects[i] = allocate(i, region, clock);
+
+        if (i % 16 == 0) {
+#if defined STM_MALLOC || defined STR_MALLOC
+            scm_tick();
+#elif defined STRMC_MALLOC
+            scm_tick_clock(clock);
+#endif
+        }
+    }
+
+#if defined STR_MALLOC || defined STRMC_MALLOC
+    scm_unregister_region(region);
+#ifdef STRMC_MALLOC
+    scm_unregister_clock(clock);
+#endif
+#elif defined MALLOC_ONLY
+    for (i = 0; i < objects_per_thread; i++) {
+        free(objects[i]);
+    }
+#endif
+    churn->work_cycles = bench_cycles() - start;
+    PERF_PHASE_STOP(churn->work_perf, objects_per_thread - 1);
+
+    churn->returned_at = bench_cycles();
+
+    return NULL;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr, "usage: %s [-n threads] [-t threads per wave] "
+            "[-o objects per thread]\n", program);
+    exit(-1);
+}
+
+int main(int argc, char **argv) {
+    int option;
+    unsigned long i, started = 0;
+
+    while ((option = getopt(argc, argv, "n:t:o:")) != -1) {
+        switch (option) {
+            case 'n':
+                number_of_threads = bench_parse_ul("-n", optarg);
+                break;
+            case 't':
+                threads_per_wave = bench_parse_ul("-t", optarg);
+                break;
+            case 'o':
+                objects_per_thread = bench_parse_ul("-o", optarg);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+
+#ifdef BENCH_USES_LIBSCM
+    count_finalizer_id = scm_register_finalizer(count_finalizer);
+#endif
+
+    churn_thread_t *wave = calloc(threads_per_wave, sizeof(churn_thread_t));
+
+    uint64_t first_call_cycles = 0;
+    uint64_t work_cycles = 0;
+    uint64_t exit_cycles = 0;
+
+    PERF_PHASE(first_call_perf)
+    PERF_PHASE(work_perf)
+    PERF_PHASE_INIT_TOTAL(first_call_perf, "first_call");
+    PERF_PHASE_INIT_TOTAL(work_perf, "work");
+
+    uint64_t start = bench_nsec();
+
+    while (started < number_of_threads) {
+        unsigned long in_wave = number_of_threads - started;
+
+        if (in_wave > threads_per_wave) in_wave = threads_per_wave;
+
+        for (i = 0; i < in_wave; i++) {
+            if (pthread_create(&wave[i].thread, NULL, run_thread,
+                    &wave[i]) != 0) {
+                fprintf(stderr, "Failed to start thread %lu\n", started + i);
+                exit(-1);
+            }
+        }
+        for (i = 0; i < in_wave; i++) {
+            pthread_join(wave[i].thread, NULL);
+
+            uint64_t joined_at = bench_cycles();
+
+            PERF_PHASE_MERGE(first_call_perf, wave[i].first_call_perf);
+            PERF_PHASE_MERGE(work_perf, wave[i].work_perf);
+
+            first_call_cycles += wave[i].first_call_cycles;
+            work_cycles += wave[i].work_cycles;
+            if (joined_at > wave[i].returned_at) {
+                exit_cycles += joined_at - wave[i].returned_at;
+            }
+        }
+        started += in_wave;
+    }
+
+    double seconds = (bench_nsec() - start) / 1e9;
+
+    struct mallinfo2 info = mallinfo2();
+
+    printf("mode %s threads %lu wave %lu objects %lu\n", BENCH_MODE,
+            number_of_threads, threads_per_wave, objects_per_thread);
+    printf("threads_per_second %.0f\n", number_of_threads / seconds);
+    printf("approx_register_cycles %.0f\n",
+            (double) first_call_cycles / number_of_threads);
+    printf("work_cycles %.0f\n", (double) work_cycles / number_of_threads);
+    printf("approx_unregister_cycles %.0f\n",
+            (double) exit_cycles / number_of_threads);
+    printf("approx_process_heap_kb %zu\n", info.uordblks / 1024);
+    printf("rss_kb %ld\n", bench_rss_kb());
+#ifdef STM_MALLOC
+    printf("objects_reclaimed %lu of %lu\n", objects_reclaimed,
+            number_of_threads * objects_per_thread);
+#endif
+
+    PERF_PHASE_REPORT(first_call_perf);
+    PERF_PHASE_REPORT(work_perf);
+
+    free(wave);
+
+    return 0;
+}
@@ -0,0 +1,698 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+/*
+ * Lock-free containers that reclaim their nodes with the global time.
+ *
+ * Nodes are allocated with scm_malloc and never refreshed, so they live
+ * until the thread that unlinked a node passes it to scm_retire. The node
+ * is freed after the global time advanced twice, i.e. after every thread
+ * that participates in the global time passed through scm_quiescent or
+ * scm_global_tick. Threads hold references to nodes only within a
+ * container call, which is why they may call scm_quiescent after any call.
+ * A node is never reused while a thread may still read it, so the
+ * compare-and-exchange loops below do not suffer from the ABA problem.
+ *
+ * Removed nodes of the map and the skip list are marked by setting the
+ * lowest bit of their next pointer (Harris), which keeps other threads from
+ * linking nodes behind them. Only the thread whose compare-and-exchange
+ * unlinks a marked node retires it.
+ */
+
+#include "scm.h"
+
+#define MARKED(_ptr) ((void*) ((uintptr_t) (_ptr) | 1))
+#define UNMARKED(_ptr) ((void*) ((uintptr_t) (_ptr) & ~(uintptr_t) 1))
+#define IS_MARKED(_ptr) (((uintptr_t) (_ptr)) & 1)
+
+#define LOAD(_link) atomic_pointer_load_acquire((void * volatile *) &(_link))
+#define CAS(_link, _old, _new) \
+    compare_and_exchange((void * volatile *) &(_link), (_old), (_new))
+
+#define SKIPLIST_MAX_LEVEL 20
+
+#define DEFAULT_MAP_BUCKETS 1024
+
+// keeps the head and the tail of the queue in separate cache lines
+#define CACHE_LINE_SIZE 64
+
+typedef struct queue_node queue_node_t;
+
+struct queue_node {
+    void * volatile value;
+    queue_node_t * volatile next;
+};
+
+/*
+ * Michael-Scott queue: head points to a dummy node whose successor holds
+ * the first value. A dequeue retires the former dummy node.
+ */
+struct scm_queue {
+    queue_node_t * volatile head;
+    char padding[CACHE_LINE_SIZE - sizeof(queue_node_t*)];
+    queue_node_t * volatile tail;
+};
+
+typedef struct map_node map_node_t;
+
+struct map_node {
+    unsigned long key;
+    // NULL once the node is removed
+    void * volatile value;
+    map_node_t * volatile next;
+};
+
+/*
+ * Hash map with a fixed number of buckets, each a lock-free list sorted by
+ * key (Harris-Michael).
+ */
+struct scm_map {
+    // a power of two
+    size_t number_of_buckets;
+    map_node_t * volatile *buckets;
+};
+
+typedef struct skiplist_node skiplist_node_t;
+
+struct skiplist_node {
+    unsigned long key;
+    // NULL once the node is removed
+    void * volatile value;
+    // levels the node is linked in plus one while it is being inserted,
+    // the node is retired when the count drops to zero
+    volatile int links;
+    int height;
+    skiplist_node_t * volatile next[];
+};
+
+/*
+ * Skip list in which a node is removed by marking its links from the top
+ * down (Fraser). Marking the bottom link removes the node, the following
+ * search unlinks it from all levels.
+ */
+struct scm_skiplist {
+    skiplist_node_t *head;
+};
+
+// state of the random number generator of the node heights
+static __thread unsigned int skiplist_seed;
+
+static unsigned int seed_counter;
+
+// true if newval was stored, failed attempts to help other threads are
+// not retried
+static inline bool compare_and_exchange(void * volatile *link,
+        void *oldval, void *newval) {
+    return atomic_pointer_compare_and_exchange(link, oldval, newval)
+        == oldval;
+}
+
+/**
+ * Threads that use a container must participate in the global time before
+ * they load a node, otherwise the global time may advance twice while they
+ * hold a reference.
+ */
+static inline void enter_container(void) {
+    if (descriptor_root == NULL) {
+        create_descriptor_root();
+    }
+}
+
+static inline size_t bucket_of(scm_map_t *map, unsigned long key) {
+    // Fibonacci hashing, the high bits are the best mixed
+    unsigned long long hash = key * 11400714819323198485ULL;
+
+    return (size_t) (hash >> 32) & (map->number_of_buckets - 1);
+}
+
+/**
+ * scm_queue_create() allocates the queue and its dummy node.
+ */
+scm_queue_t *scm_queue_create(void) {
+    scm_queue_t *queue = __real_malloc(sizeof(scm_queue_t));
+    queue_node_t *dummy = scm_malloc(sizeof(queue_node_t));
+
+    if (queue == NULL || dummy == NULL) {
+#ifdef SCM_DEBUG
+        printf("Memory for queue could not be allocated.\n");
+#endif
+        __real_free(queue);
+        scm_free(dummy);
+        return NULL;
+    }
+
+    dummy->value = NULL;
+    dummy->next = NULL;
+
+    queue->head = dummy;
+    queue->tail = dummy;
+
+    return queue;
+}
+
+/**
+ * scm_queue_destroy() frees the nodes that are still in the queue. Retired
+ * nodes are freed when they expire.
+ */
+void scm_queue_destroy(scm_queue_t *queue) {
+    queue_node_t *node = queue->head;
+
+    while (node != NULL) {
+        queue_node_t *next = node->next;
+        scm_free(node);
+        node = next;
+    }
+
+    __real_free(queue);
+}
+
+int scm_queue_enqueue(scm_queue_t *queue, void *value) {
+    queue_node_t *node = scm_malloc(sizeof(queue_node_t));
+
+    if (node == NULL) {
+#ifdef SCM_DEBUG
+        printf("Memory for queue node could not be allocated.\n");
+#endif
+        return -1;
+    }
+
+    node->value = value;
+    node->next = NULL;
+
+    enter_container();
+
+    while (1) {
+        queue_node_t *tail = LOAD(queue->tail);
+        queue_node_t *next = LOAD(tail->next);
+
+        if (tail != LOAD(queue->tail)) continue;
+
+        if (next == NULL) {
+            if (CAS(tail->next, NULL, node)) {
+                //the tail may lag behind, every thread helps to advance it
+                CAS(queue->tail, tail, node);
+                return 0;
+            }
+        } else {
+            CAS(queue->tail, tail, next);
+        }
+    }
+}
+
+void *scm_queue_dequeue(scm_queue_t *queue) {
+    enter_container();
+
+    while (1) {
+        queue_node_t *head = LOAD(queue->head);
+        queue_node_t *tail = LOAD(queue->tail);
+        queue_node_t *next = LOAD(head->next);
+
+        if (head != LOAD(queue->head)) continue;
+
+        if (next == NULL) {
+            //empty
+            return NULL;
+        }
+
+        if (head == tail) {
+            CAS(queue->tail, tail, next);
+            continue;
+        }
+
+        //next becomes the dummy node, its value is read before other
+        //threads may dequeue it
+        void *value = next->value;
+
+        if (CAS(queue->head, head, next)) {
+            scm_retire(head);
+            return value;
+        }
+    }
+}
+
+/**
+ * Searches the bucket for key and unlinks the marked nodes on the way.
+ * Returns true if an unmarked node with key was found. *prev_link is the
+ * link to *curr, the first node whose key is not less than key.
+ */
+static bool map_find(map_node_t * volatile *bucket, unsigned long key,
+        map_node_t * volatile **prev_link, map_node_t **curr) {
+retry:
+    {
+        map_node_t * volatile *prev = bucket;
+        map_node_t *node = LOAD(*prev);
+
+        while (node != NULL) {
+            map_node_t *next = LOAD(node->next);
+
+            if (IS_MARKED(next)) {
+                if (!CAS(*prev, node, UNMARKED(next))) goto retry;
+
+                scm_retire(node);
+                node = UNMARKED(next);
+                continue;
+            }
+
+            if (node->key >= key) break;
+
+            prev = &node->next;
+            node = next;
+        }
+
+        *prev_link = prev;
+        *curr = node;
+
+        return node != NULL && node->key == key;
+    }
+}
+
+/**
+ * scm_map_create() allocates a map with buckets buckets, rounded up to a
+ * power of two (DEFAULT_MAP_BUCKETS if 0). The map is never resized.
+ */
+scm_map_t *scm_map_create(size_t buckets) {
+    size_t number_of_buckets = 1;
+
+    if (buckets == 0) buckets = DEFAULT_MAP_BUCKETS;
+
+    while (number_of_buckets < buckets) {
+        if (number_of_buckets > SIZE_MAX / (2 * sizeof(map_node_t*))) {
+            return NULL;
+        }
+        number_of_buckets *= 2;
+    }
+
+    scm_map_t *map = __real_malloc(sizeof(scm_map_t));
+    map_node_t * volatile *array =
+        __real_calloc(number_of_buckets, sizeof(map_node_t*));
+
+    if (map == NULL || array == NULL) {
+#ifdef SCM_DEBUG
+        printf("Memory for map could not be allocated.\n");
+#endif
+        __real_free(map);
+        __real_free((void*) array);
+        return NULL;
+    }
+
+    map->number_of_buckets = number_of_buckets;
+    map->buckets = array;
+
+    return map;
+}
+
+/**
+ * scm_map_destroy() frees the nodes that are still linked. Retired nodes
+ * are freed when they expire.
+ */
+void scm_map_destroy(scm_map_t *map) {
+    size_t i;
+
+    for (i = 0; i < map->number_of_buckets; i++) {
+        map_node_t *node = map->buckets[i];
+
+        while (node != NULL) {
+            map_node_t *next = UNMARKED(node->next);
+            scm_free(node);
+            node = next;
+        }
+    }
+
+    __real_free((void*) map->buckets);
+    __real_free(map);
+}
+
+int scm_map_put(scm_map_t *map, unsigned long key, void *value) {
+    map_node_t * volatile *bucket = &map->buckets[bucket_of(map, key)];
+    map_node_t * volatile *prev;
+    map_node_t *curr;
+    map_node_t *node = NULL;
+
+    enter_container();
+
+    while (1) {
+        if (map_find(bucket, key, &prev, &curr)) {
+            void *old_value = LOAD(curr->value);
+
+            //a NULL value means the node is being removed, the next
+            //search unlinks it
+            if (old_value != NULL && CAS(curr->value, old_value, value)) {
+                //the new node was never published
+                scm_free(node);
+                return 0;
+            }
+            continue;
+        }
+
+        if (node == NULL) {
+            node = scm_malloc(sizeof(map_node_t));
+
+            if (node == NULL) {
+#ifdef SCM_DEBUG
+                printf("Memory for map node could not be allocated.\n");
+#endif
+                return -1;
+            }
+
+            node->key = key;
+            node->value = value;
+        }
+
+        node->next = curr;
+
+        if (CAS(*prev, curr, node)) return 0;
+    }
+}
+
+void *scm_map_get(scm_map_t *map, unsigned long key) {
+    map_node_t *node;
+
+    enter_container();
+
+    node = LOAD(map->buckets[bucket_of(map, key)]);
+
+    //marked nodes are passed but not unlinked
+    while (node != NULL && node->key < key) {
+        node = UNMARKED(LOAD(node->next));
+    }
+
+    if (node == NULL || node->key != key) return NULL;
+
+    return LOAD(node->value);
+}
+
+void *scm_map_remove(scm_map_t *map, unsigned long key) {
+    map_node_t * volatile *bucket = &map->buckets[bucket_of(map, key)];
+    map_node_t * volatile *prev;
+    map_node_t *curr;
+
+    enter_container();
+
+    while (1) {
+        if (!map_find(bucket, key, &prev, &curr)) return NULL;
+
+        map_node_t *next = LOAD(curr->next);
+
+        if (IS_MARKED(next)) continue;
+
+        //the thread that marks the node removes it
+        if (!CAS(curr->next, next, MARKED(next))) continue;
+
+        //a concurrent put either replaced the value before or fails
+        void *value = atomic_pointer_exchange_acquire(
+                (void * volatile *) &curr->value, NULL);
+
+        if (CAS(*prev, curr, next)) {
+            scm_retire(curr);
+        } else {
+            //the node is unlinked by the search
+            map_find(bucket, key, &prev, &curr);
+        }
+
+        return value;
+    }
+}
+
+/**
+ * Returns a height between 1 and SKIPLIST_MAX_LEVEL, where height h has
+ * probability 2^-h.
+ */
+static int random_height(void) {
+    unsigned int x = skiplist_seed;
+
+    if (x == 0) {
+        x = 2654435761U * (unsigned int)
+            (atomic_int_exchange_and_add_relaxed((int*) &seed_counter, 1) + 1);
+        if (x == 0) x = 1;
+    }
+
+    //xorshift32
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    skiplist_seed = x;
+
+    return bsfl((int) (x | (1U << (SKIPLIST_MAX_LEVEL - 1)))) + 1;
+}
+
+/**
+ * Drops a link of the node and retires the node when it is neither linked
+ * anymore nor being inserted.
+ */
+static inline void release_skiplist_node(skiplist_node_t *node) {
+    if (atomic_int_dec_and_test(&node->links)) {
+        scm_retire(node);
+    }
+}
+
+/**
+ * Searches for key on all levels and unlinks the marked nodes on the way.
+ * preds[level] is the last node whose key is less than key and
+ * succs[level] its successor. Returns true if succs[0] is an unmarked
+ * node with key.
+ */
+static bool skiplist_find(scm_skiplist_t *list, unsigned long key,
+        skiplist_node_t **preds, skiplist_node_t **succs) {
+    int level;
+
+retry:
+    {
+        skiplist_node_t *pred = list->head;
+
+        for (level = SKIPLIST_MAX_LEVEL - 1; level >= 0; level--) {
+            skiplist_node_t *curr = LOAD(pred->next[level]);
+
+            //pred is being removed
+            if (IS_MARKED(curr)) goto retry;
+
+            while (curr != NULL) {
+                skiplist_node_t *succ = LOAD(curr->next[level]);
+
+                if (IS_MARKED(succ)) {
+                    if (!CAS(pred->next[level], curr, UNMARKED(succ))) {
+                        goto retry;
+                    }
+                    release_skiplist_node(curr);
+                    curr = UNMARKED(succ);
+                    continue;
+                }
+
+                if (curr->key >= key) break;
+
+                pred = curr;
+                curr = succ;
+            }
+
+            preds[level] = pred;
+            succs[level] = curr;
+        }
+
+        return succs[0] != NULL && succs[0]->key == key;
+    }
+}
+
+/**
+ * scm_skiplist_create() allocates an empty skip list.
+ */
+scm_skiplist_t *scm_skiplist_create(void) {
+    scm_skiplist_t *list = __real_malloc(sizeof(scm_skiplist_t));
+    skiplist_node_t *head = scm_malloc(sizeof(skiplist_node_t) +
+            SKIPLIST_MAX_LEVEL * sizeof(skiplist_node_t*));
+
+    if (list == NULL || head == NULL) {
+#ifdef SCM_DEBUG
+        printf("Memory for skip list could not be allocated.\n");
+#endif
+        __real_free(list);
+        scm_free(head);
+        return NULL;
+    }
+
+    memset(head, 0, sizeof(skiplist_node_t) +
+            SKIPLIST_MAX_LEVEL * sizeof(skiplist_node_t*));
+    head->height = SKIPLIST_MAX_LEVEL;
+    list->head = head;
+
+    return list;
+}
+
+/**
+ * scm_skiplist_destroy() frees the nodes that are still linked. A node is
+ * freed on the lowest level it is linked in. Retired nodes are freed when
+ * they expire.
+ */
+void scm_skiplist_destroy(scm_skiplist_t *list) {
+    int level;
+
+    for (level = SKIPLIST_MAX_LEVEL - 1; level >= 0; level--) {
+        skiplist_node_t *node = UNMARKED(list->head->next[level]);
+
+        while (node != NULL) {
+            skiplist_node_t *next = UNMARKED(node->next[level]);
+
+            if (--node->links == 0) scm_free(node);
+
+            node = next;
+        }
+    }
+
+    scm_free(list->head);
+    __real_free(list);
+}
+
+int scm_skiplist_put(scm_skiplist_t *list, unsigned long key, void *value) {
+    skiplist_node_t *preds[SKIPLIST_MAX_LEVEL];
+    skiplist_node_t *succs[SKIPLIST_MAX_LEVEL];
+    skiplist_node_t *node = NULL;
+    int level;
+
+    enter_container();
+
+    while (1) {
+        if (skiplist_find(list, key, preds, succs)) {
+            void *old_value = LOAD(succs[0]->value);
+
+            if (old_value != NULL &&
+                    CAS(succs[0]->value, old_value, value)) {
+                //the new node was never published
+                scm_free(node);
+                return 0;
+            }
+            continue;
+        }
+
+        if (node == NULL) {
+            int height = random_height();
+
+            node = scm_malloc(sizeof(skiplist_node_t) +
+                    height * sizeof(skiplist_node_t*));
+
+            if (node == NULL) {
+#ifdef SCM_DEBUG
+                printf("Memory for skip list node could not be allocated.\n");
+#endif
+                return -1;
+            }
+
+            node->key = key;
+            node->value = value;
+            //held by this thread until the insertion is complete
+            node->links = 1;
+            node->height = height;
+        }
+
+        for (level = 0; level < node->height; level++) {
+            node->next[level] = succs[level];
+        }
+
+        atomic_int_inc(&node->links);
+
+        //the node is in the list once it is linked on the bottom level
+        if (CAS(preds[0]->next[0], succs[0], node)) break;
+
+        atomic_int_add_relaxed(&node->links, -1);
+    }
+
+    for (level = 1; level < node->height; level++) {
+        while (1) {
+            skiplist_node_t *next = LOAD(node->next[level]);
+
+            //the node is being removed, stop linking it
+            if (IS_MARKED(next)) goto linked;
+
+            if (next != succs[level] &&
+                    !CAS(node->next[level], next, succs[level])) {
+                continue;
+            }
+
+            atomic_int_inc(&node->links);
+
+            if (CAS(preds[level]->next[level], succs[level], node)) break;
+
+            atomic_int_add_relaxed(&node->links, -1);
+
+            skiplist_find(list, key, preds, succs);
+
+            //the node has been removed and unlinked already
+            if (succs[0] != node) goto linked;
+        }
+    }
+
+linked:
+    //levels linked after the remover searched are unlinked here
+    if (IS_MARKED(LOAD(node->next[0]))) {
+        skiplist_find(list, key, preds, succs);
+    }
+
+    release_skiplist_node(node);
+
+    return 0;
+}
+
+void *scm_skiplist_get(scm_skiplist_t *list, unsigned long key) {
+    skiplist_node_t *pred = list->head;
+    skiplist_node_t *curr = NULL;
+    int level;
+
+    enter_container();
+
+    //marked nodes are passed but not unlinked
+    for (level = SKIPLIST_MAX_LEVEL - 1; level >= 0; level--) {
+        curr = UNMARKED(LOAD(pred->next[level]));
+
+        while (curr != NULL && curr->key < key) {
+            pred = curr;
+            curr = UNMARKED(LOAD(curr->next[level]));
+        }
+    }
+
+    if (curr == NULL || curr->key != key) return NULL;
+
+    return LOAD(curr->value);
+}
+
+void *scm_skiplist_remove(scm_skiplist_t *list, unsigned long key) {
+    skiplist_node_t *preds[SKIPLIST_MAX_LEVEL];
+    skiplist_node_t *succs[SKIPLIST_MAX_LEVEL];
+    int level;
+
+    enter_container();
+
+    if (!skiplist_find(list, key, preds, succs)) return NULL;
+
+    skiplist_node_t *node = succs[0];
+
+    //mark the upper levels so that no nodes are linked behind the node
+    for (level = node->height - 1; level > 0; level--) {
+        skiplist_node_t *next = LOAD(node->next[level]);
+
+        while (!IS_MARKED(next)) {
+            CAS(node->next[level], next, MARKED(next));
+            next = LOAD(node->next[level]);
+        }
+    }
+
+    skiplist_node_t *next = LOAD(node->next[0]);
+
+    while (1) {
+        //another thread removed the node
+        if (IS_MARKED(next)) return NULL;
+
+        if (CAS(node->next[0], next, MARKED(next))) break;
+
+        next = LOAD(node->next[0]);
+    }
+
+    //a concurrent put either replaced the value before or fails
+    void *value = atomic_pointer_exchange_acquire(
+            (void * volatile *) &node->value, NULL);
+
+    //unlinks the node on all levels
+    skiplist_find(list, key, preds, succs);
+
+    return value;
+}
@@ -6,20 +6,14 @@
  */
 
 #include "descriptors.h"
-
-/**
- * Increments the current_index modulo the maximal expiration extension.
- */
-inline void increment_current_index(descriptor_buffer_t *buffer) {
-    buffer->current_index = (buffer->current_index + 1) % buffer->not_expired_length;
-}
+#include "pool.h"
 
 /**
  * Returns a descriptor page from the descriptor page
  * pool or allocates a new descriptor page if the
  * descriptor page pool is empty.
  */
-static descriptor_page_t *new_descriptor_page() {
+descriptor_page_t *new_descriptor_page() {
 
     descriptor_page_t *new_page = NULL;
 
@@ -55,33 +49,306 @@ static descriptor_page_t *new_descriptor_page() {
     return new_page;
 }
 
-/*
- * Inserts a descriptor for the object or region
- * provided as parameter 'ptr' */
-void insert_descriptor(void* ptr, descriptor_buffer_t *buffer,
-                       unsigned int expiration) {
+/**
+ * Takes a region page from the region page pool or allocates a new one and
+ * makes it the page of the tick arena that is filled next.
+ */
+region_page_t *new_tick_arena_page(tick_arena_t *arena) {
+    region_page_t *page = descriptor_root->region_page_pool;
+
+    if (page != NULL) {
+        descriptor_root->region_page_pool = page->nextPage;
+        descriptor_root->number_of_pooled_region_pages--;
+#ifdef SCM_RECORD_MEMORY_USAGE
+        dec_pooled_mem(sizeof(region_page_t));
+#endif
+    } else {
+        page = __real_malloc(SCM_REGION_PAGE_SIZE);
+
+        if (page == NULL) {
+#ifdef SCM_DEBUG
+            printf("Memory for tick arena page could not be allocated.\n");
+#endif
+            return NULL;
+        }
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+        inc_overhead(__real_malloc_usable_size(page) - SCM_REGION_PAGE_PAYLOAD_SIZE);
+        inc_allocated_mem(__real_malloc_usable_size(page));
+#endif
+    }
+
+    page->nextPage = arena->first_page;
+    arena->first_page = page;
+    arena->next_free_address = page->memory;
+    arena->last_address_in_first_page =
+        page->memory + SCM_REGION_PAGE_PAYLOAD_SIZE;
+
+    return page;
+}
+
+/**
+ * Returns the pages of a tick arena to the region page pool as long as
+ * there is space in the pool and frees the others.
+ */
+void expire_tick_arena(tick_arena_t *arena) {
+    region_page_t *page = arena->first_page;
+
+    while (page != NULL) {
+        region_page_t *next_page = page->nextPage;
+
+        if (descriptor_root->number_of_pooled_region_pages <
+                SCM_REGION_PAGE_FREELIST_SIZE) {
+            page->nextPage = descriptor_root->region_page_pool;
+            descriptor_root->region_page_pool = page;
+            descriptor_root->number_of_pooled_region_pages++;
+#ifdef SCM_RECORD_MEMORY_USAGE
+            inc_pooled_mem(SCM_REGION_PAGE_SIZE);
+#endif
+        } else {
+#ifdef SCM_RECORD_MEMORY_USAGE
+            dec_overhead(__real_malloc_usable_size(page) - SCM_REGION_PAGE_PAYLOAD_SIZE);
+            inc_freed_mem(__real_malloc_usable_size(page));
+#endif
+            __real_free(page);
+        }
 
-    unsigned int insert_index = (buffer->current_index + expiration) % buffer->not_expired_length;
+        page = next_page;
+    }
+
+    arena->first_page = NULL;
+    arena->next_free_address = NULL;
+    arena->last_address_in_first_page = NULL;
+}
+
+/**
+ * Returns the first entry of the probe sequence of target, pointers are
+ * spread with Fibonacci hashing.
+ */
+static inline unsigned int lease_slot(lease_table_t *table, void *target) {
+    return (unsigned int) ((((uintptr_t) target >> 3)
+        * 11400714819323198485ULL) >> 32) & (table->capacity - 1);
+}
 
-    descriptor_page_list_t *list = &buffer->not_expired[insert_index];
+lease_t *find_lease(lease_table_t *table, void *target) {
+    if (table->count == 0) return NULL;
+
+    unsigned int i = lease_slot(table, target);
+
+    while (table->entries[i].target != NULL) {
+        if (table->entries[i].target == target) return &table->entries[i];
+
+        i = (i + 1) & (table->capacity - 1);
+    }
+
+    return NULL;
+}
+
+/**
+ * Doubles the capacity of the table and rehashes its leases.
+ */
+static int grow_lease_table(lease_table_t *table) {
+    unsigned int capacity = table->capacity == 0 ? 16 : table->capacity * 2;
+    lease_t *entries = __real_calloc(capacity, sizeof(lease_t));
 
-    if (list->first == NULL) {
-        list->first = new_descriptor_page();
-        list->last = list->first;
+    if (entries == NULL) {
+#ifdef SCM_DEBUG
+        printf("Memory for lease table could not be allocated.\n");
+#endif
+        return -1;
     }
 
-    //insert in the last page
-    descriptor_page_t *page = list->last;
+    lease_t *old_entries = table->entries;
+    unsigned int old_capacity = table->capacity;
+
+    table->entries = entries;
+    table->capacity = capacity;
+
+    unsigned int i;
 
-    if (page->number_of_descriptors == DESCRIPTORS_PER_PAGE) {
-        //page is full. create new page and append to end of list
-        page = new_descriptor_page();
-        list->last->next = page;
-        list->last = page;
+    for (i = 0; i < old_capacity; i++) {
+        if (old_entries[i].target == NULL) continue;
+
+        unsigned int j = lease_slot(table, old_entries[i].target);
+
+        while (entries[j].target != NULL) {
+            j = (j + 1) & (capacity - 1);
+        }
+        entries[j] = old_entries[i];
     }
 
-    page->descriptors[page->number_of_descriptors] = ptr;
-    page->number_of_descriptors++;
+#ifdef SCM_RECORD_MEMORY_USAGE
+    inc_overhead((capacity - old_capacity) * sizeof(lease_t));
+#endif
+
+    __real_free(old_entries);
+
+    return 0;
+}
+
+lease_t *add_lease(lease_table_t *table, void *target) {
+    if (2 * (table->count + 1) > table->capacity
+            && grow_lease_table(table) != 0) {
+        return NULL;
+    }
+
+    unsigned int i = lease_slot(table, target);
+
+    while (table->entries[i].target != NULL) {
+        i = (i + 1) & (table->capacity - 1);
+    }
+
+    table->entries[i].target = target;
+    table->count++;
+
+    return &table->entries[i];
+}
+
+/**
+ * Removes the lease without tombstones: the following entries of the
+ * probe sequence are shifted back into the gap if their home slot allows.
+ */
+void remove_lease(lease_table_t *table, lease_t *lease) {
+    unsigned int mask = table->capacity - 1;
+    unsigned int gap = lease - table->entries;
+    unsigned int i = gap;
+
+    for (;;) {
+        i = (i + 1) & mask;
+
+        if (table->entries[i].target == NULL) break;
+
+        unsigned int home = lease_slot(table, table->entries[i].target);
+
+        //move the entry unless its home lies cyclically in (gap, i]
+        if (((i - home) & mask) >= ((i - gap) & mask)) {
+            table->entries[gap] = table->entries[i];
+            gap = i;
+        }
+    }
+
+    table->entries[gap].target = NULL;
+    table->count--;
+}
+
+/**
+ * Ends the leases of a clock that is unregistered or whose thread
+ * terminates. Every lease becomes a descriptor that expires period ticks
+ * of the clock later, which takes over the counter increment of the lease.
+ */
+void end_leases(const unsigned int clock) {
+    lease_table_t *table = &descriptor_root->leases[clock];
+    unsigned int i;
+
+    for (i = 0; i < table->capacity; i++) {
+        lease_t *lease = &table->entries[i];
+
+        if (lease->target == NULL) continue;
+
+        insert_descriptor(lease->target, lease->region ?
+            &descriptor_root->locally_clocked_reg_buffer[clock] :
+            &descriptor_root->locally_clocked_obj_buffer[clock],
+            lease->period);
+    }
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    dec_overhead(table->capacity * sizeof(lease_t));
+#endif
+
+    __real_free(table->entries);
+
+    table->entries = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+/**
+ * Parks the memory block of an expired object in the recycle cache of the
+ * calling thread. The block is freed if its bin is full or too large.
+ * Pool objects return to their pool.
+ */
+void recycle_object(object_header_t *object) {
+    if (is_pool_object(object)) {
+        release_pool_object(object);
+        return;
+    }
+
+    void *chunk = OBJECT_CHUNK(object);
+    size_t usable_size = __real_malloc_usable_size(chunk);
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    dec_overhead(sizeof(object_header_t));
+    inc_freed_mem(usable_size);
+#endif
+
+    // blocks of aligned objects cannot be reused for other objects
+    if (SCM_RECYCLE_CACHE_BIN_LENGTH == 0 || chunk != (void*) object
+            || usable_size < 8 || RECYCLE_BIN(usable_size) >= RECYCLE_BINS) {
+        __real_free(chunk);
+        return;
+    }
+
+    recycle_bin_t *bin = &descriptor_root->recycle_cache[
+        RECYCLE_BIN(usable_size)];
+
+    if (bin->length >= SCM_RECYCLE_CACHE_BIN_LENGTH) {
+        __real_free(chunk);
+        return;
+    }
+
+    *(object_header_t**) PAYLOAD_OFFSET(object) = bin->first;
+    bin->first = object;
+    bin->length++;
+    descriptor_root->number_of_recycled_objects++;
+}
+
+/**
+ * Frees half of the blocks of every bin that were not needed since the
+ * last trim. Called at tick, so unused blocks return to the allocator
+ * within a few ticks.
+ */
+void trim_recycle_cache() {
+    int i;
+
+    for (i = 0; i < RECYCLE_BINS; i++) {
+        recycle_bin_t *bin = &descriptor_root->recycle_cache[i];
+        unsigned int to_be_freed = (bin->low_water + 1) / 2;
+
+        descriptor_root->number_of_recycled_objects -= to_be_freed;
+        bin->length -= to_be_freed;
+
+        while (to_be_freed-- > 0) {
+            object_header_t *object = bin->first;
+
+            bin->first = *(object_header_t**) PAYLOAD_OFFSET(object);
+            __real_free(object);
+        }
+
+        bin->low_water = bin->length;
+    }
+}
+
+/**
+ * Frees all blocks of the recycle cache.
+ */
+void flush_recycle_cache() {
+    int i;
+
+    for (i = 0; i < RECYCLE_BINS; i++) {
+        recycle_bin_t *bin = &descriptor_root->recycle_cache[i];
+
+        while (bin->first != NULL) {
+            object_header_t *object = bin->first;
+
+            bin->first = *(object_header_t**) PAYLOAD_OFFSET(object);
+            __real_free(object);
+        }
+
+        bin->length = 0;
+        bin->low_water = 0;
+    }
+
+    descriptor_root->number_of_recycled_objects = 0;
 }
 
 /*
@@ -238,11 +505,7 @@ int expire_object_descriptor_if_exists(expired_descriptor_page_list_t *list) {
                    (unsigned long) PAYLOAD_OFFSET(expired_object));
 #endif
 
-#ifdef SCM_RECORD_MEMORY_USAGE
-            dec_overhead(sizeof(object_header_t));
-            inc_freed_mem(__real_malloc_usable_size(expired_object));
-#endif
-            __real_free(expired_object);
+            recycle_object(expired_object);
 
             return 1;
         } else {
@@ -11,6 +11,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #include "debug.h"
 #include "arch.h"
@@ -144,12 +145,198 @@ struct region {
     void* last_address_in_last_page;
 };
 
+/*
+ * A tick arena holds the objects allocated by scm_malloc_for that expire
+ * in the same slot of a clock. Objects are bump-allocated into region
+ * pages, which are linked through nextPage with the page being filled
+ * first. All pages are released when the slot expires.
+ */
+typedef struct tick_arena tick_arena_t;
+
+struct tick_arena {
+    region_page_t *first_page;
+    char *next_free_address;
+    char *last_address_in_first_page;
+};
+
+/*
+ * A pool allocates objects of a fixed size from pool pages, which are
+ * taken from an address range reserved for all pools (see pool.h).
+ * Every object has an object header, so pool objects are refreshed and
+ * expire like other objects. Expired objects return to the free_list of
+ * their pool if they expire in the thread that owns the pool, otherwise
+ * they are pushed to the remote_free_list, which the owner takes over when
+ * its free_list is empty.
+ *
+ * A destroyed pool, or a pool of a terminated thread, has no owner and
+ * keeps its pages, since its objects may still have descriptors. It is
+ * adopted with its pages by the next pool created for objects of the same
+ * slot size and alignment.
+ */
+typedef struct pool pool_t;
+
+struct pool {
+    // size of the payload
+    size_t object_size;
+    // distance between two object headers in a pool page
+    size_t slot_size;
+    // offset of the first object header in a pool page
+    size_t first_slot;
+
+    object_header_t *free_list;
+    object_header_t * volatile remote_free_list;
+
+    // bump pointer in the last pool page
+    char *next_free_slot;
+    char *last_slot;
+
+    // NULL if the pool is orphaned
+    struct descriptor_root * volatile owner;
+    // next orphaned pool
+    pool_t *next;
+};
+
+/*
+ * The recycle cache keeps the memory blocks of expired objects for reuse by
+ * the allocating thread. Bin i holds blocks with at least 16 * i + 8
+ * usable bytes, which are the size classes of glibc on 64-bit systems.
+ * The blocks of a bin are linked through their payload.
+ */
+#define RECYCLE_BIN(_usable_size) (((_usable_size) - 8) / 16)
+#define RECYCLE_BINS (RECYCLE_BIN(SCM_RECYCLE_CACHE_SIZE + 15) + 1)
+
+typedef struct recycle_bin recycle_bin_t;
+
+struct recycle_bin {
+    object_header_t *first;
+    unsigned int length;
+    // minimal length since the last trim, blocks below it were not needed
+    unsigned int low_water;
+};
+
+/*
+ * A lease keeps an object or a region alive with a single descriptor
+ * counter increment instead of a descriptor per tick. The leases of a
+ * clock form an open-addressing hash table keyed by the object header or
+ * the region, capacity is zero or a power of two and at most half of the
+ * entries are used. A lease ends with a descriptor that expires period
+ * ticks later.
+ */
+typedef struct lease lease_t;
+
+struct lease {
+    // object header or region, NULL if the entry is empty
+    void *target;
+    unsigned int period;
+    bool region;
+};
+
+typedef struct lease_table lease_table_t;
+
+struct lease_table {
+    lease_t *entries;
+    unsigned int capacity;
+    unsigned int count;
+};
+
+/*
+ * The parameters of a lifetime class validated for the heap and the clocks
+ * of a descriptor root. version is the version of the class they were
+ * taken from, 0 before they are taken for the first time and after a clock
+ * of the thread was registered or unregistered. max_extension is the limit
+ * of the heap the extension was checked against.
+ */
+typedef struct lifetime_cache lifetime_cache_t;
+
+struct lifetime_cache {
+    long version;
+    unsigned int max_extension;
+    unsigned int extension;
+    unsigned int clock;
+    bool valid;
+};
+
+#ifdef SCM_MEMORY_BUDGETS
+/*
+ * A byte budget of a clock or a thread. used is the number of bytes of the
+ * objects and regions whose descriptors have not expired yet, counted once
+ * per descriptor. A limit of 0 means no budget.
+ */
+typedef struct memory_budget memory_budget_t;
+
+struct memory_budget {
+    size_t limit;
+    size_t used;
+    int policy;
+};
+#endif
+
+typedef struct pointer_vector pointer_vector_t;
+
+struct pointer_vector {
+    void **items;
+    size_t length;
+    size_t capacity;
+};
+
+/*
+ * State of scm_refresh_graph, kept between calls to reuse its memory.
+ * visited is an open-addressing hash set of the payloads and regions the
+ * walk reached, objects and regions are the batches of descriptors that
+ * are inserted at the end of the walk.
+ */
+typedef struct graph_walk graph_walk_t;
+
+struct graph_walk {
+    pointer_vector_t stack;
+    pointer_vector_t objects;
+    pointer_vector_t regions;
+
+    void **visited;
+    size_t number_visited;
+    // a power of two
+    size_t visited_capacity;
+};
+
 /**
  * Descriptor root holds thread-local data for descriptor
  * and region management.
  */
 typedef struct descriptor_root descriptor_root_t;
 
+/*
+ * A heap is an independent instance of short-term memory with its own
+ * global time and tuning. A thread has a descriptor root for every heap
+ * it used, descriptor_root is the one of the current heap of the thread.
+ * Objects are not bound to a heap, their descriptors are.
+ */
+struct scm_heap {
+    volatile long global_time;
+
+    //the number of threads registered for global time advance
+    unsigned int number_of_threads;
+
+    //the number of threads, that have not yet ticked in a global period
+    unsigned int ticked_threads_countdown;
+
+    //protects global_time, number_of_threads, and ticked_threads_countdown
+    pthread_mutex_t global_time_lock;
+
+    descriptor_root_t *terminated_descriptor_roots;
+
+    //protects the data structures of terminated threads
+    pthread_mutex_t terminated_descriptor_roots_lock;
+
+    // runtime limits, at most SCM_MAX_EXPIRATION_EXTENSION and
+    // SCM_MAX_CLOCKS
+    unsigned int max_extension;
+    unsigned int max_clocks;
+
+    // position in heaps and in the heap roots of every thread
+    unsigned int index;
+    bool used;
+};
+
 struct descriptor_root {
     // global_phase indicates if the thread has already ticked in the current 
     // global phase. A global phase is the interval between two increments of
@@ -188,6 +375,12 @@ struct descriptor_root {
     // thread participates in global time protocol if flag is false
     bool blocked;
 
+    // the heap of the descriptor root
+    scm_heap_t *heap;
+
+    // the thread was blocked by switching to another heap
+    bool parked;
+
     // A pool of descriptor pages for re-use.
     descriptor_page_t* descriptor_page_pool[SCM_DESCRIPTOR_PAGE_FREELIST_SIZE];
     unsigned long number_of_pooled_descriptor_pages;
@@ -198,6 +391,36 @@ struct descriptor_root {
     region_page_t* region_page_pool;
     unsigned long number_of_pooled_region_pages;
 
+    // tick arenas of the slots of the locally clocked buffers
+    tick_arena_t tick_arenas[SCM_MAX_CLOCKS][SCM_MAX_EXPIRATION_EXTENSION + 1];
+
+    pool_t *pools[SCM_MAX_POOLS];
+
+    // leases of the locally clocked buffers
+    lease_table_t leases[SCM_MAX_CLOCKS];
+
+    // ring buffers owned by the thread, see ring.h
+    struct ring *rings;
+
+    // buffers of scm_refresh_graph
+    graph_walk_t graph_walk;
+
+    // parameters of the lifetime classes, see scm_lifetime_class
+    lifetime_cache_t lifetime_classes[SCM_MAX_LIFETIME_CLASSES];
+
+#ifdef SCM_MEMORY_BUDGETS
+    memory_budget_t clock_budgets[SCM_MAX_CLOCKS];
+    memory_budget_t thread_budget;
+
+    // bytes charged to the slots of the locally clocked buffers, released
+    // when the slot expires
+    size_t budget_slot_bytes[SCM_MAX_CLOCKS][SCM_MAX_EXPIRATION_EXTENSION + 1];
+#endif
+
+    // Blocks of expired objects for re-use by scm_malloc.
+    recycle_bin_t recycle_cache[RECYCLE_BINS];
+    unsigned long number_of_recycled_objects;
+
     // Singly-linked list of terminated descriptor_roots.
     // This is only used after the thread terminated.
     descriptor_root_t *next;
@@ -205,14 +428,150 @@ struct descriptor_root {
 
 extern __thread descriptor_root_t* descriptor_root;
 
-inline void increment_current_index(descriptor_buffer_t *buffer)
+/* Registers the calling thread in its current heap unless it is already */
+void create_descriptor_root()
+    __attribute__((visibility("hidden")));
+
+/* Returns a pooled or newly allocated descriptor page */
+descriptor_page_t *new_descriptor_page()
+    __attribute__((visibility("hidden")));
+
+/* Adds a region page to the tick arena, returns NULL if out of memory */
+region_page_t *new_tick_arena_page(tick_arena_t *arena)
+    __attribute__((visibility("hidden")));
+
+/* Releases all objects of the tick arena of a just expired slot */
+void expire_tick_arena(tick_arena_t *arena)
     __attribute__((visibility("hidden")));
 
-/* Takes an object or a region as parameter ptr */
-void insert_descriptor(void* ptr,
-                       descriptor_buffer_t *buffer, unsigned int expiration)
+/* Returns the lease of the target in the table or NULL */
+lease_t *find_lease(lease_table_t *table, void *target)
     __attribute__((visibility("hidden")));
 
+/* Adds an empty lease for the target, returns NULL if out of memory */
+lease_t *add_lease(lease_table_t *table, void *target)
+    __attribute__((visibility("hidden")));
+
+/* Removes a lease returned by find_lease from the table */
+void remove_lease(lease_table_t *table, lease_t *lease)
+    __attribute__((visibility("hidden")));
+
+/* Ends all leases of the clock with descriptors and frees the table */
+void end_leases(const unsigned int clock)
+    __attribute__((visibility("hidden")));
+
+/* Parks the block of an expired object in the recycle cache or frees it */
+void recycle_object(object_header_t *object)
+    __attribute__((visibility("hidden")));
+
+/* Frees the blocks that were not needed since the last trim */
+void trim_recycle_cache()
+    __attribute__((visibility("hidden")));
+
+/* Frees all blocks of the recycle cache */
+void flush_recycle_cache()
+    __attribute__((visibility("hidden")));
+
+/**
+ * Returns a cached block for an object of size bytes including its header
+ * or NULL if the recycle cache has none.
+ */
+static inline object_header_t *recycled_object(size_t size) {
+    if (size > SCM_RECYCLE_CACHE_SIZE) return NULL;
+
+    recycle_bin_t *bin = &descriptor_root->recycle_cache[
+        size <= 8 ? 0 : RECYCLE_BIN(size + 15)];
+    object_header_t *object = bin->first;
+
+    if (object == NULL) return NULL;
+
+    bin->first = *(object_header_t**) PAYLOAD_OFFSET(object);
+    bin->length--;
+    if (bin->length < bin->low_water) {
+        bin->low_water = bin->length;
+    }
+    descriptor_root->number_of_recycled_objects--;
+
+    return object;
+}
+
+/**
+ * Increments the current_index modulo the maximal expiration extension.
+ */
+static inline void increment_current_index(descriptor_buffer_t *buffer) {
+    buffer->current_index = (buffer->current_index + 1) % buffer->not_expired_length;
+}
+
+/*
+ * Inserts a descriptor for the object or region
+ * provided as parameter 'ptr'. Inlined into the refresh paths, only
+ * the allocation of a new descriptor page leaves the fast path.
+ */
+static inline void insert_descriptor(void* ptr, descriptor_buffer_t *buffer,
+                       unsigned int expiration) {
+
+    unsigned int insert_index = (buffer->current_index + expiration) % buffer->not_expired_length;
+
+    descriptor_page_list_t *list = &buffer->not_expired[insert_index];
+
+    if (__builtin_expect(list->first == NULL, 0)) {
+        list->first = new_descriptor_page();
+        list->last = list->first;
+    }
+
+    //insert in the last page
+    descriptor_page_t *page = list->last;
+
+    if (__builtin_expect(page->number_of_descriptors == DESCRIPTORS_PER_PAGE, 0)) {
+        //page is full. create new page and append to end of list
+        page = new_descriptor_page();
+        list->last->next = page;
+        list->last = page;
+    }
+
+    page->descriptors[page->number_of_descriptors] = ptr;
+    page->number_of_descriptors++;
+}
+
+/*
+ * Inserts count descriptors like insert_descriptor but copies them into
+ * the pages of the descriptor list a page at a time.
+ */
+static inline void insert_descriptors(void **ptrs, size_t count,
+        descriptor_buffer_t *buffer, unsigned int expiration) {
+
+    if (count == 0) return;
+
+    unsigned int insert_index = (buffer->current_index + expiration) % buffer->not_expired_length;
+
+    descriptor_page_list_t *list = &buffer->not_expired[insert_index];
+
+    if (__builtin_expect(list->first == NULL, 0)) {
+        list->first = new_descriptor_page();
+        list->last = list->first;
+    }
+
+    descriptor_page_t *page = list->last;
+
+    while (count > 0) {
+        if (page->number_of_descriptors == DESCRIPTORS_PER_PAGE) {
+            page = new_descriptor_page();
+            list->last->next = page;
+            list->last = page;
+        }
+
+        size_t free_descriptors =
+            DESCRIPTORS_PER_PAGE - page->number_of_descriptors;
+        size_t n = count < free_descriptors ? count : free_descriptors;
+
+        memcpy(&page->descriptors[page->number_of_descriptors], ptrs,
+                n * sizeof(void*));
+        page->number_of_descriptors += n;
+        ptrs += n;
+        count -= n;
+    }
+}
+
 /* Expires the descriptor buffer by appending
  * the just-expired descriptors to the
  * list_of_expired_[obj|reg]_descriptors. */
@@ -0,0 +1,65 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "libscm.h"
+
+#define LOOPRUNS 100
+
+static int finalized = 0;
+static int refusals = 0;
+
+int count_finalizer(void *ptr) {
+	finalized++;
+	return 0;
+}
+
+//keeps the object alive the first time it runs
+int refusing_finalizer(void *ptr) {
+	refusals++;
+	return refusals == 1;
+}
+
+void check(int condition, const char *message) {
+	if(!condition) {
+		printf("prog4: %s\n", message);
+		exit(1);
+	}
+}
+
+int main(int argc, char** argv) {
+
+	int i;
+
+	const int counting = scm_register_finalizer(count_finalizer);
+	const int refusing = scm_register_finalizer(refusing_finalizer);
+
+	//scm_free_now runs the finalizer exactly once, with and without
+	//descriptors of the object
+	for(i=0; i<LOOPRUNS; i++) {
+		void* ptr = scm_malloc(64);
+		scm_set_finalizer(ptr, counting);
+		if(i % 2 == 0) {
+			scm_refresh(ptr, 1);
+		}
+		scm_free_now(ptr);
+	}
+	for(i=0; i<3; i++) {
+		scm_tick();
+	}
+	scm_collect();
+	check(finalized == LOOPRUNS, "finalizer did not run exactly once");
+
+	//a refusing finalizer of an object without descriptors runs once and
+	//leaves the object alone
+	void* kept = scm_malloc(64);
+	scm_set_finalizer(kept, refusing);
+	scm_free_now(kept);
+	check(refusals == 1, "refusing finalizer ran more than once");
+
+	//the object is still alive and freed by the next call
+	scm_free_now(kept);
+	check(refusals == 2, "finalizer of the kept object did not run again");
+
+	printf("prog4: success!\n");
+	return 0;
+}
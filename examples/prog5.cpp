@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <coroutine>
+#include <memory_resource>
+
+#include "scm.hpp"
+
+#define LOOPRUNS 30
+
+static int destroyed = 0;
+
+struct session {
+	int id;
+
+	explicit session(int i) : id(i) {}
+
+	~session() {
+		destroyed++;
+	}
+};
+
+static void check(bool condition, const char *message) {
+	if(!condition) {
+		std::printf("prog5: %s\n", message);
+		std::exit(1);
+	}
+}
+
+//a coroutine that is resumed once per request step
+struct request {
+	struct promise_type : scm::short_term_promise<> {
+		request get_return_object() {
+			return request(
+				std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() { std::abort(); }
+	};
+
+	explicit request(std::coroutine_handle<promise_type> h) : handle(h) {}
+	request(const request &) = delete;
+	~request() { handle.destroy(); }
+
+	std::coroutine_handle<promise_type> handle;
+};
+
+static int steps = 0;
+
+request handle_request(int size) {
+	auto &frame = co_await scm::this_frame;
+
+	char *buffer = static_cast<char*>(frame.allocate(size));
+	std::memset(buffer, 'x', size);
+	steps++;
+
+	co_await std::suspend_always{};
+
+	check(buffer[size - 1] == 'x', "coroutine memory was overwritten");
+	steps++;
+}
+
+int main(int argc, char** argv) {
+
+	int i;
+
+	//region_allocator: the vector is abandoned, the region reclaims it
+	const int region = scm_create_region();
+	check(region >= 0, "no region available");
+	{
+		scm::region_allocator<int> allocator(region);
+		std::vector<int, scm::region_allocator<int>> v(allocator);
+		for(i=0; i<LOOPRUNS; i++) {
+			v.push_back(i);
+		}
+		check(v[LOOPRUNS - 1] == LOOPRUNS - 1, "region vector is wrong");
+	}
+	scm_refresh_region(region, 0);
+	scm_unregister_region(region);
+
+	//short_term_resource: blocks expire one tick after allocation
+	{
+		scm::short_term_resource resource(1);
+		std::pmr::vector<int> v(&resource);
+		for(i=0; i<LOOPRUNS; i++) {
+			v.push_back(i);
+		}
+		check(v[LOOPRUNS - 1] == LOOPRUNS - 1, "short-term vector is wrong");
+	}
+	scm_tick();
+
+	//make_short_term: the destructor runs as finalizer on expiration
+	for(i=0; i<LOOPRUNS; i++) {
+		auto s = scm::make_short_term<session>(i);
+		check(s->id == i, "short-term object is wrong");
+	}
+	scm_tick();
+	scm_collect();
+	check(destroyed == LOOPRUNS, "destructors did not run on expiration");
+
+	//heap_scope: objects of another heap expire with its clock
+	{
+		scm::heap_scope scope(scm::heap<1, 2>::instance());
+		void *ptr = scm_malloc(64);
+		scm_refresh(ptr, 1);
+		scm_tick();
+		scm_tick();
+	}
+
+	//short_term_promise: every co_await ticks the clock
+	{
+		request r = handle_request(128);
+		r.handle.resume();
+		check(steps == 1, "coroutine did not run its first step");
+		r.handle.resume();
+		check(steps == 2 && r.handle.done(), "coroutine did not finish");
+	}
+	scm_tick();
+
+	std::printf("prog5: success!\n");
+	return 0;
+}
@@ -4,4 +4,6 @@ export LD_LIBRARY_PATH=../dist
 
 ./prog1
 ./prog2
-./prog3
\ No newline at end of file
+./prog3
+./prog4
+./prog5
\ No newline at end of file
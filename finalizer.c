@@ -5,20 +5,54 @@
  * can be found in the LICENSE file.
  */
 
+#include <stdio.h>
+
 #include "finalizer.h"
 
-//finalizer table contains function pointers;
-static int (*finalizer_table[SCM_FINALIZER_TABLE_SIZE])(void*);
+//finalizer table contains function pointers and pointer offsets
+static type_descriptor_t finalizer_table[SCM_FINALIZER_TABLE_SIZE];
 
 //bump pointer on the finalizer table
 static int finalizer_index = 0;
 
 int scm_register_finalizer(int(*scm_finalizer)(void*)) {
-    int index = atomic_int_exchange_and_add(&finalizer_index, 1);
+    int index = atomic_int_exchange_and_add_relaxed(&finalizer_index, 1);
 
     if (index >= SCM_FINALIZER_TABLE_SIZE) return -1; //error, table full
 
-    finalizer_table[index] = scm_finalizer;
+    finalizer_table[index].finalizer = scm_finalizer;
+
+    return index;
+}
+
+int scm_register_type(const size_t *pointer_offsets,
+        unsigned int number_of_offsets, int(*scm_finalizer)(void*)) {
+    size_t *offsets = NULL;
+
+    if (number_of_offsets > 0) {
+        offsets = __real_malloc(number_of_offsets * sizeof(size_t));
+
+        if (offsets == NULL) {
+#ifdef SCM_DEBUG
+            printf("Memory for type descriptor could not be allocated.\n");
+#endif
+            return -1;
+        }
+
+        memcpy(offsets, pointer_offsets, number_of_offsets * sizeof(size_t));
+    }
+
+    int index = atomic_int_exchange_and_add_relaxed(&finalizer_index, 1);
+
+    if (index >= SCM_FINALIZER_TABLE_SIZE) {
+        //error, table full
+        __real_free(offsets);
+        return -1;
+    }
+
+    finalizer_table[index].finalizer = scm_finalizer;
+    finalizer_table[index].pointer_offsets = offsets;
+    finalizer_table[index].number_of_offsets = number_of_offsets;
 
     return index;
 }
@@ -26,6 +60,10 @@ int scm_register_finalizer(int(*scm_finalizer)(void*)) {
 void scm_set_finalizer(void *ptr, int scm_finalizer_id) {
     //set function index
     object_header_t *o = OBJECT_HEADER(ptr);
+
+    //objects of tick arenas are released without running finalizers
+    if (o->dc_or_region_id == TICK_ARENA_OBJECT) return;
+
     o->finalizer_index = scm_finalizer_id;
 }
 
@@ -33,13 +71,26 @@ void scm_set_finalizer(void *ptr, int scm_finalizer_id) {
 int run_finalizer(object_header_t *o) {
     //INVARIANT: object o is already expired
 
-    if (o->finalizer_index == -1) return 0; //object has no finalizer
+    return run_finalizer_index(o, o->finalizer_index);
+}
+
+int run_finalizer_index(object_header_t *o, int finalizer_index) {
+    if (finalizer_index == -1) return 0; //object has no finalizer
 
     void *ptr = PAYLOAD_OFFSET(o);
     int (*finalizer)(void*);
     //get function pointer to objects finalizer
-    finalizer = finalizer_table[o->finalizer_index];
+    finalizer = finalizer_table[finalizer_index].finalizer;
+
+    //a type without finalizer
+    if (finalizer == NULL) return 0;
 
     //run finalizer and return the result of it
     return (*finalizer)(ptr);
+}
+
+type_descriptor_t *get_type_descriptor(int index) {
+    if (index < 0 || index >= SCM_FINALIZER_TABLE_SIZE) return NULL;
+
+    return &finalizer_table[index];
 }
\ No newline at end of file
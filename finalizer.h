@@ -10,12 +10,36 @@
 
 #include "arch.h"
 #include "object.h"
+#include "libscm.h"
 
 #ifndef SCM_FINALIZER_TABLE_SIZE
 #define SCM_FINALIZER_TABLE_SIZE 32
 #endif
 
+/*
+ * An entry of the finalizer table. Types registered with scm_register_type
+ * also list the offsets of the pointer fields of their objects, which
+ * scm_refresh_graph follows.
+ */
+typedef struct type_descriptor type_descriptor_t;
+
+struct type_descriptor {
+    // NULL if objects of the type have no finalizer
+    int (*finalizer)(void*);
+    size_t *pointer_offsets;
+    unsigned int number_of_offsets;
+};
+
 int run_finalizer(object_header_t *o)
     __attribute__((visibility("hidden")));
 
+/* Runs the finalizer with the given index, e.g. after it was taken from the
+ * object with an atomic exchange */
+int run_finalizer_index(object_header_t *o, int finalizer_index)
+    __attribute__((visibility("hidden")));
+
+/* Returns the type of a finalizer index or NULL if there is none */
+type_descriptor_t *get_type_descriptor(int finalizer_index)
+    __attribute__((visibility("hidden")));
+
 #endif	/* _FINALIZER_H_ */
\ No newline at end of file
@@ -10,6 +10,13 @@
 
 #include <string.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the public API remains visible if libscm is built with -fvisibility=hidden
+#pragma GCC visibility push(default)
+
 /*
  * One may use the following compile time configuration for libscm.
  * See Makefile for different configurations.
@@ -36,6 +43,14 @@
  * turn on eager collection
  * #define SCM_EAGER_COLLECTION
  *
+ * track the bytes kept alive by the descriptors of every clock and thread
+ * and enforce the budgets of scm_set_clock_budget and scm_set_thread_budget
+ * #define SCM_MEMORY_BUDGETS
+ *
+ * use the x86 inline assembler atomics, which are full barriers, instead of
+ * the C11 atomics with relaxed memory orders (see arch.h)
+ * #define SCM_ATOMICS_ASM
+ *
  * the size of the descriptor pages. this should be a power of two and a
  * multiple of sizeof(void*)
  * #define SCM_DESCRIPTOR_PAGE_SIZE 4096
@@ -45,6 +60,28 @@
  * an upper bound on the number of descriptor pages that are cached
  * #define SCM_DESCRIPTOR_PAGE_FREELIST_SIZE 10
  *
+ * expired objects whose memory block has at most SCM_RECYCLE_CACHE_SIZE
+ * usable bytes are kept in a per-thread cache and reused by scm_malloc.
+ * Every size class of the cache holds up to SCM_RECYCLE_CACHE_BIN_LENGTH
+ * blocks, 0 disables the cache
+ * #define SCM_RECYCLE_CACHE_SIZE 1024
+ * #define SCM_RECYCLE_CACHE_BIN_LENGTH 32
+ *
+ * the number of pools per thread, the size of a pool page (a power of two)
+ * and the address space reserved for the pages of all pools
+ * #define SCM_MAX_POOLS 10
+ * #define SCM_POOL_PAGE_SIZE 65536
+ * #define SCM_POOL_ARENA_SIZE (1UL << 30)
+ *
+ * the number of ring buffers of all threads
+ * #define SCM_MAX_RINGS 10
+ *
+ * the number of heaps of the process including the default heap
+ * #define SCM_MAX_HEAPS 4
+ *
+ * the number of lifetime classes of the process
+ * #define SCM_MAX_LIFETIME_CLASSES 16
+ *
  * the maximal expiration extension allowed on the scm_refresh calls
  * #define SCM_MAX_EXPIRATION_EXTENSION 5
  *
@@ -65,6 +102,14 @@
 #define SCM_DESCRIPTOR_PAGE_FREELIST_SIZE 10
 #endif
 
+#ifndef SCM_RECYCLE_CACHE_SIZE
+#define SCM_RECYCLE_CACHE_SIZE 1024
+#endif
+
+#ifndef SCM_RECYCLE_CACHE_BIN_LENGTH
+#define SCM_RECYCLE_CACHE_BIN_LENGTH 32
+#endif
+
 #ifndef SCM_REGION_PAGE_SIZE
 #define SCM_REGION_PAGE_SIZE 4096
 #endif
@@ -77,6 +122,30 @@
 #define SCM_MAX_REGIONS 10
 #endif
 
+#ifndef SCM_MAX_POOLS
+#define SCM_MAX_POOLS 10
+#endif
+
+#ifndef SCM_POOL_PAGE_SIZE
+#define SCM_POOL_PAGE_SIZE 65536
+#endif
+
+#ifndef SCM_POOL_ARENA_SIZE
+#define SCM_POOL_ARENA_SIZE (1UL << 30)
+#endif
+
+#ifndef SCM_MAX_RINGS
+#define SCM_MAX_RINGS 10
+#endif
+
+#ifndef SCM_MAX_HEAPS
+#define SCM_MAX_HEAPS 4
+#endif
+
+#ifndef SCM_MAX_LIFETIME_CLASSES
+#define SCM_MAX_LIFETIME_CLASSES 16
+#endif
+
 #ifndef SCM_MAX_CLOCKS
 #define SCM_MAX_CLOCKS 10
 #endif
@@ -109,6 +178,55 @@ int scm_register_finalizer(int(*scm_finalizer)(void*));
  */
 void scm_set_finalizer(void *ptr, int scm_finalizer_id);
 
+/**
+ * scm_register_type registers the layout of objects whose pointer fields
+ * are at the byte offsets pointer_offsets[0 .. number_of_offsets - 1] of
+ * the payload together with a finalizer, which may be NULL. The returned
+ * type id is a finalizer id that is bound to objects with
+ * scm_set_finalizer, see scm_refresh_graph. Returns -1 if the finalizer
+ * table is full.
+ */
+int scm_register_type(const size_t *pointer_offsets,
+        unsigned int number_of_offsets, int(*scm_finalizer)(void*));
+
+/**
+ * A heap is an independent instance of short-term memory with its own
+ * global time, clocks, regions and pools. Threads use the default heap
+ * until they switch to another one. A thread that does not tick a heap
+ * only delays the reclamation of descriptors in that heap.
+ */
+typedef struct scm_heap scm_heap_t;
+
+/**
+ * scm_heap_create() returns a new heap whose refresh calls accept
+ * extensions up to max_extension and which has up to max_clocks clocks
+ * per thread (both at most the compile time limits, 0 for the limit), or
+ * NULL if SCM_MAX_HEAPS heaps exist already. Calls with a clock beyond
+ * max_clocks are ignored in the heap. Heaps are never destroyed.
+ */
+scm_heap_t *scm_heap_create(unsigned int max_extension,
+        unsigned int max_clocks);
+
+/**
+ * scm_heap_default() returns the heap that threads use initially.
+ */
+scm_heap_t *scm_heap_default(void);
+
+/**
+ * scm_heap_switch() makes heap the current heap of the calling thread,
+ * i.e. all other calls of the thread operate on heap, and returns the
+ * previous heap or NULL if heap is invalid. The thread is blocked in the
+ * previous heap (see scm_block_thread) until it switches back.
+ */
+scm_heap_t *scm_heap_switch(scm_heap_t *heap);
+
+/**
+ * scm_heap_set_max_extension() changes the maximal extension of the refresh
+ * calls in heap, which is at most SCM_MAX_EXPIRATION_EXTENSION.
+ */
+void scm_heap_set_max_extension(scm_heap_t *heap,
+        unsigned int max_extension);
+
 /**
  * scm_register_clock() returns a const integer representing
  * a new clock in the short-term memory model.
@@ -143,6 +261,171 @@ const int scm_create_region();
  */
 void scm_unregister_region(const int region);
 
+/**
+ * scm_pool_create() returns a new pool of the calling thread for objects of
+ * object_size bytes, whose payload is aligned to alignment (a power of two,
+ * 0 for the default alignment). Returns -1 if all pools are in use or the
+ * objects do not fit into a pool page.
+ */
+const int scm_pool_create(size_t object_size, size_t alignment);
+
+/**
+ * scm_malloc_in_pool() allocates an object from a pool. Pool objects are
+ * refreshed, pinned and freed like objects allocated with scm_malloc. On
+ * expiration they return to their pool, also if they expire in another
+ * thread, so the memory of a pool is reused only for objects of the pool.
+ */
+void *scm_malloc_in_pool(const int pool);
+
+/**
+ * scm_pool_destroy() releases a pool of the calling thread, which must not
+ * allocate from it afterwards. Objects of the pool still expire normally,
+ * the memory of the pool is reused by a later pool for objects of the same
+ * size and alignment. The pools of a thread are released when it
+ * terminates.
+ */
+void scm_pool_destroy(const int pool);
+
+/**
+ * scm_malloc_for() allocates an object that expires after the clock ticked
+ * extension + 1 times, like an object allocated by scm_malloc and refreshed
+ * once with scm_refresh_with_clock(ptr, extension, clock). No descriptor is
+ * created: the object is bump-allocated into an arena of all objects with
+ * the same expiration, which is released at once. The object cannot be
+ * refreshed, pinned, freed or finalized, such calls are ignored.
+ */
+void *scm_malloc_for(size_t size, unsigned int extension,
+        const unsigned int clock);
+
+/**
+ * scm_lease() keeps an object alive on the given clock until
+ * scm_lease_cancel() is called, without refreshing it on every tick.
+ * After the lease is cancelled the object expires when the clock ticked
+ * period more times. Leasing a leased object changes its period. If the
+ * object is part of a region, the region is leased instead. Leases of a
+ * clock end when the clock is unregistered or the thread terminates.
+ */
+void scm_lease(void *ptr, unsigned int period, const unsigned int clock);
+
+/**
+ * scm_lease_cancel() ends the lease of an object on the given clock.
+ */
+void scm_lease_cancel(void *ptr, const unsigned int clock);
+
+/**
+ * A lifetime class names an extension and a clock, e.g. of the objects of a
+ * request. Refreshing objects with a class instead of an (extension, clock)
+ * pair changes the lifetime of all of them when the class is retuned.
+ *
+ * scm_lifetime_class() returns the id of the class with the given name,
+ * which is registered with extension and clock if it does not exist yet.
+ * Returns -1 if SCM_MAX_LIFETIME_CLASSES classes exist already.
+ */
+const int scm_lifetime_class(const char *name, unsigned int extension,
+        const unsigned int clock);
+
+/**
+ * scm_lifetime_class_set() retunes a lifetime class. Refreshes of all
+ * threads use the new parameters from their next refresh with the class on.
+ */
+void scm_lifetime_class_set(const int lifetime_class, unsigned int extension,
+        const unsigned int clock);
+
+/**
+ * scm_refresh_class() refreshes an object with the extension and clock of
+ * a lifetime class, which are validated once per thread and class version
+ * instead of on every call. If the object is part of a region, the region
+ * is refreshed instead.
+ */
+void scm_refresh_class(void *ptr, const int lifetime_class);
+
+/**
+ * scm_refresh_region_class() refreshes a region with a lifetime class.
+ */
+void scm_refresh_region_class(const int region_index,
+        const int lifetime_class);
+
+/**
+ * scm_malloc_class() allocates an object that is refreshed with a lifetime
+ * class. Returns NULL with errno EINVAL if the class does not exist or its
+ * clock is not registered by the calling thread.
+ */
+void *scm_malloc_class(size_t size, const int lifetime_class);
+
+/**
+ * Policies of memory budgets:
+ *
+ *  SCM_BUDGET_TICK     the clock is ticked until the budget holds again,
+ *                      which shortens the lifetime of all objects of the
+ *                      clock like a call of scm_tick_clock
+ *  SCM_BUDGET_SHORTEN  the new descriptor gets extension 0, so the bytes
+ *                      are released at the next tick, but usage is not
+ *                      bounded before that tick
+ *  SCM_BUDGET_FAIL     scm_malloc_for and scm_malloc_class return NULL,
+ *                      refreshes are not affected
+ */
+#define SCM_BUDGET_TICK 0
+#define SCM_BUDGET_SHORTEN 1
+#define SCM_BUDGET_FAIL 2
+
+/**
+ * scm_set_clock_budget() limits the bytes that the not yet expired
+ * descriptors of a clock of the calling thread keep alive. Every descriptor
+ * counts the usable size of its object or the pages of its region, the
+ * global clock is not counted. A leased object is charged when its lease
+ * ends and it gets a descriptor. The policy applies when a refresh, an
+ * allocation or scm_lease_cancel would exceed the budget, but not when the
+ * leases end because the clock or thread is unregistered. 0 bytes removes
+ * the budget, which also ends when the clock is unregistered. Requires
+ * SCM_MEMORY_BUDGETS.
+ */
+void scm_set_clock_budget(const unsigned int clock, size_t bytes,
+        int policy);
+
+/**
+ * scm_set_thread_budget() limits the bytes of all clocks of the calling
+ * thread, see scm_set_clock_budget. A tick forced by the thread budget
+ * ticks the clock that is refreshed.
+ */
+void scm_set_thread_budget(size_t bytes, int policy);
+
+/**
+ * scm_clock_usage() and scm_thread_usage() return the bytes charged to a
+ * clock and to all clocks of the calling thread, 0 without
+ * SCM_MEMORY_BUDGETS.
+ */
+size_t scm_clock_usage(const unsigned int clock);
+size_t scm_thread_usage(void);
+
+/**
+ * scm_ring_create() returns a new ring buffer of at least bytes bytes for
+ * the given clock of the calling thread, or -1 if no ring is available.
+ * Records are allocated from the ring in FIFO order and released without
+ * descriptors: every tick of the clock releases the records allocated
+ * before the previous tick, i.e. a record lives until the clock ticked
+ * twice. Records are never refreshed or freed individually.
+ */
+const int scm_ring_create(size_t bytes, const unsigned int clock);
+
+/**
+ * scm_ring_create_spsc() is scm_ring_create() for a ring into which one
+ * other thread (the producer) allocates, while the calling thread (the
+ * consumer) ticks the clock.
+ */
+const int scm_ring_create_spsc(size_t bytes, const unsigned int clock);
+
+/**
+ * scm_ring_malloc() appends a record of size bytes to the ring. Returns
+ * NULL if the ring is full, i.e. the clock has to tick first.
+ */
+void *scm_ring_malloc(const int ring, size_t size);
+
+/**
+ * scm_ring_destroy() frees a ring of the calling thread. Its records must
+ * not be used anymore.
+ */
+void scm_ring_destroy(const int ring);
+
 /**
  * scm_malloc() allocates short-term memory objects. This function
  * can be used at compile time. Unmodified code which uses e.g. glibc's
@@ -167,6 +450,19 @@ void* scm_malloc_in_region(size_t size, const int region_index);
  */
 void scm_free(void *ptr);
 
+/**
+ * scm_free_now() frees an object that is known to be dead even if it still
+ * has descriptors. Its finalizer runs immediately (if the finalizer returns
+ * non-zero, nothing happens). An object without descriptors is freed like
+ * with scm_free. Otherwise the whole pages of its payload are returned to
+ * the operating system at once and the rest of the object is freed when its
+ * last descriptor expires. An object smaller than a page has no whole pages,
+ * it only loses its finalizer and keeps its memory until then. The object
+ * must not be used afterwards. Objects in a region cannot be freed
+ * individually.
+ */
+void scm_free_now(void *ptr);
+
 /*
  * scm_collect may be called at any appropriate time in the program. It
  * processes all expired descriptors of the calling thread and frees objects
@@ -192,6 +488,40 @@ void scm_refresh_with_clock(void *ptr, unsigned int extension, const unsigned in
  */
 void scm_refresh(void *ptr, unsigned int extension);
 
+/**
+ * scm_refresh_multi() refreshes an object with every clock i whose bit
+ * (1UL << i) is set in clock_mask with extension extensions[i], like one
+ * scm_refresh_with_clock call per clock but with a single update of the
+ * descriptor counter. extensions is indexed by clock, entries of clocks
+ * that are not in the mask are not read. Clocks that the calling thread
+ * has not registered are ignored. If the object is part of a region, the
+ * region is refreshed instead.
+ */
+void scm_refresh_multi(void *ptr, unsigned long clock_mask,
+        const unsigned int *extensions);
+
+/**
+ * scm_refresh_region_multi() refreshes a region with multiple clocks, see
+ * scm_refresh_multi.
+ */
+void scm_refresh_region_multi(const int region_index,
+        unsigned long clock_mask, const unsigned int *extensions);
+
+/**
+ * scm_refresh_graph() refreshes every object reachable from root exactly
+ * once with a given clock. The walk follows the pointer fields of objects
+ * that have a type (see scm_register_type), which must be NULL or point to
+ * objects allocated by libscm. Objects of a region are not refreshed
+ * individually, their region is refreshed once. Pinned objects are
+ * traversed but not refreshed. Returns 0 on success and -1 if root is NULL
+ * or the clock is invalid (errno EINVAL), or if the walk ran out of memory
+ * (errno ENOMEM). In the latter case only part of the graph was refreshed
+ * and the remaining objects may expire early, so the caller must refresh
+ * the graph again or keep its objects alive otherwise.
+ */
+int scm_refresh_graph(void *root, unsigned int extension,
+        const unsigned int clock);
+
 /**
  * scm_global_refresh() adds extension time units to the expiration time of
  * ptr and takes care that all other threads have enough time to also call
@@ -223,6 +553,22 @@ void scm_refresh_region(const int region_id, unsigned int extension);
  */
 void scm_global_refresh_region(const int region_id, unsigned int extension);
 
+/**
+ * scm_pin() makes an object permanent: it is not freed when its descriptors
+ * expire and refreshing it has no effect, so no descriptors are created.
+ * If the object is part of a region, the region is pinned instead.
+ * A pinned object may be freed with scm_free. If it still has descriptors,
+ * it is freed when the last of them expires.
+ */
+void scm_pin(void *ptr);
+
+/**
+ * scm_unpin() returns a pinned object (or region) to short-term memory
+ * management. Descriptors created before the object was pinned still
+ * count, otherwise the object has to be refreshed to expire again.
+ */
+void scm_unpin(void *ptr);
+
 /**
  * scm_tick_clock() advances the time of the given thread-local clock
  */
@@ -238,4 +584,103 @@ void scm_tick(void);
  */
 void scm_global_tick(void);
 
+/**
+ * scm_retire() is meant for lock-free data structures: ptr, which has been
+ * unlinked from the data structure, is freed once the global time advanced
+ * twice, i.e. when every thread that is not blocked has passed through a
+ * quiescent state (scm_quiescent or scm_global_tick) since the call.
+ * Readers must not hold references to shared objects across a quiescent
+ * state.
+ */
+void scm_retire(void *ptr);
+
+/**
+ * scm_quiescent() announces that the calling thread holds no references to
+ * retired objects. It is scm_global_tick() but returns immediately if the
+ * thread announced a quiescent state in the current global period already,
+ * so it may be called often, e.g. after every operation.
+ */
+void scm_quiescent(void);
+
+/*
+ * Lock-free containers whose nodes are reclaimed with scm_retire. Every
+ * thread that uses a container has to call scm_quiescent (or
+ * scm_global_tick) from time to time, e.g. after every container call,
+ * otherwise removed nodes are never freed. A thread must not be blocked
+ * (see scm_block_thread) during a container call. Values are stored as
+ * they are and must not be NULL, the containers do not free them.
+ * Containers must not be used anymore when they are destroyed.
+ */
+
+/**
+ * An unbounded multi-producer multi-consumer FIFO queue.
+ */
+typedef struct scm_queue scm_queue_t;
+
+/**
+ * scm_queue_create() returns an empty queue or NULL if out of memory.
+ */
+scm_queue_t *scm_queue_create(void);
+void scm_queue_destroy(scm_queue_t *queue);
+
+/**
+ * scm_queue_enqueue() appends value, returns 0 or -1 if out of memory.
+ */
+int scm_queue_enqueue(scm_queue_t *queue, void *value);
+
+/**
+ * scm_queue_dequeue() removes the first value, returns NULL if the queue
+ * is empty.
+ */
+void *scm_queue_dequeue(scm_queue_t *queue);
+
+/**
+ * A hash map from keys to values with a fixed number of buckets.
+ */
+typedef struct scm_map scm_map_t;
+
+/**
+ * scm_map_create() returns an empty map with buckets buckets (rounded up to
+ * a power of two, 0 for a default) or NULL if out of memory.
+ */
+scm_map_t *scm_map_create(size_t buckets);
+void scm_map_destroy(scm_map_t *map);
+
+/**
+ * scm_map_put() maps key to value, returns 0 or -1 if out of memory.
+ */
+int scm_map_put(scm_map_t *map, unsigned long key, void *value);
+
+/**
+ * scm_map_get() returns the value of key or NULL.
+ */
+void *scm_map_get(scm_map_t *map, unsigned long key);
+
+/**
+ * scm_map_remove() removes key, returns its value or NULL if key was not
+ * in the map.
+ */
+void *scm_map_remove(scm_map_t *map, unsigned long key);
+
+/**
+ * A skip list that maps keys to values in key order.
+ */
+typedef struct scm_skiplist scm_skiplist_t;
+
+scm_skiplist_t *scm_skiplist_create(void);
+void scm_skiplist_destroy(scm_skiplist_t *list);
+
+/**
+ * The skip list functions behave like the map functions.
+ */
+int scm_skiplist_put(scm_skiplist_t *list, unsigned long key, void *value);
+void *scm_skiplist_get(scm_skiplist_t *list, unsigned long key);
+void *scm_skiplist_remove(scm_skiplist_t *list, unsigned long key);
+
+#pragma GCC visibility pop
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif	/* _LIBSCM_H_ */
\ No newline at end of file
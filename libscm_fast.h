@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+#ifndef _LIBSCM_FAST_H_
+#define	_LIBSCM_FAST_H_
+
+#include "libscm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the public API remains visible if libscm is built with -fvisibility=hidden
+#pragma GCC visibility push(default)
+
+/*
+ * Unchecked variants of the hot libscm calls for inner loops.
+ *
+ * The checked API validates its arguments, creates the descriptor root of
+ * the calling thread on demand and clamps the extension on every call.
+ * The functions below skip all of that and only do the work of the call.
+ * The caller must guarantee that:
+ *
+ *  - the calling thread is already registered in libscm, i.e. it made a
+ *    checked refresh, scm_register_clock or scm_create_region call before
+ *  - the clock is 0 or was returned by scm_register_clock and is still
+ *    registered
+ *  - the extension is not larger than SCM_MAX_EXPIRATION_EXTENSION
+ *  - ptr is not NULL and was allocated by libscm, region_id is a region
+ *    returned by scm_create_region
+ *
+ * Violating these rules corrupts the descriptor buffers of the thread.
+ *
+ * To inline the fast paths into application code link against the static
+ * library with link-time optimization enabled:
+ *
+ *   gcc -O3 -flto app.c dist/libscm.a $(WRAP) -lpthread
+ *
+ * where WRAP are the -Wl,--wrap options of the Makefile.
+ */
+
+/**
+ * scm_refresh_fast() is scm_refresh_with_clock() without argument checks.
+ * If the object is part of a region, the region is refreshed instead.
+ */
+void scm_refresh_fast(void *ptr, unsigned int extension,
+        const unsigned int clock);
+
+/**
+ * scm_refresh_region_fast() is scm_refresh_region_with_clock() without
+ * argument checks.
+ */
+void scm_refresh_region_fast(const int region_id, unsigned int extension,
+        const unsigned int clock);
+
+/**
+ * scm_tick_fast() is scm_tick_clock() without argument checks.
+ */
+void scm_tick_fast(const unsigned int clock);
+
+#pragma GCC visibility pop
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* _LIBSCM_FAST_H_ */
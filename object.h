@@ -9,6 +9,10 @@
 #define	_OBJECT_H_
 
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "preload.h"
 
 extern void* __real_malloc(size_t size);
 extern void* __real_calloc(size_t nelem, size_t elsize);
@@ -16,6 +20,23 @@ extern void* __real_realloc(void *ptr, size_t size);
 extern void __real_free(void *ptr);
 extern size_t __real_malloc_usable_size(void *ptr);
 
+// the wrappers replace the allocator of the application (-Wl,--wrap or
+// LD_PRELOAD) and must remain visible with -fvisibility=hidden
+#pragma GCC visibility push(default)
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nelem, size_t elsize);
+void *__wrap_realloc(void *ptr, size_t size);
+void __wrap_free(void *ptr);
+size_t __wrap_malloc_usable_size(void *ptr);
+#ifdef SCM_PRELOAD
+void *__wrap_memalign(size_t alignment, size_t size);
+int __wrap_posix_memalign(void **memptr, size_t alignment, size_t size);
+void *__wrap_aligned_alloc(size_t alignment, size_t size);
+void *__wrap_valloc(size_t size);
+void *__wrap_pvalloc(size_t size);
+#endif
+#pragma GCC visibility pop
+
 /*
  * objects allocated through libscm have an additional object header that
  * is located before the chunk storing the object.
@@ -42,11 +63,60 @@ struct object_header {
     // finalizer_index must be signed so that a finalizer_index
     // may be set to -1 indicating that no finalizer exists
     int finalizer_index;
+#ifdef SCM_PRELOAD
+    // The preloadable library returns 16-byte aligned payloads like the
+    // system allocator and supports aligned allocations, so the object
+    // header may start after the beginning of the allocated chunk.
+    unsigned int chunk_offset;
+    // identifies objects allocated by libscm, see preload.h
+    unsigned int owner_tag;
+#endif
 };
 
+// descriptor counter of objects allocated in a tick arena by scm_malloc_for
+// or in a ring buffer. They are never refreshed or freed individually and
+// keep the size of their payload in finalizer_index.
+#define TICK_ARENA_OBJECT INT_MAX
+
 #define OBJECT_HEADER(_ptr) \
     (object_header_t*)(_ptr - sizeof(object_header_t))
 #define PAYLOAD_OFFSET(_o) \
     ((void*)(_o) + sizeof(object_header_t))
 
+#ifdef SCM_PRELOAD
+#define OBJECT_CHUNK_OFFSET(_o) ((_o)->chunk_offset)
+#define OBJECT_TAG(_o) \
+    ((unsigned int) ((uintptr_t) (_o) >> 4) ^ 0x5c3a11edU)
+// 0 on success, -1 if the object cannot be recognized as owned by libscm
+// and must not be handed out
+#define SET_OBJECT_OWNER(_o, _chunk_offset) \
+    ((_o)->chunk_offset = _chunk_offset, \
+    (_o)->owner_tag = OBJECT_TAG(_o), \
+    mark_owned_page(_o))
+
+/*
+ * Returns non-zero if ptr is the payload of an object allocated by libscm.
+ * The header is only read if its page has been used by libscm before.
+ */
+static inline int is_scm_object(void *ptr) {
+    if ((uintptr_t) ptr < sizeof(object_header_t)) return 0;
+
+    object_header_t *object = OBJECT_HEADER(ptr);
+
+    return is_owned_page(object) && object->owner_tag == OBJECT_TAG(object);
+}
+#else
+#define OBJECT_CHUNK_OFFSET(_o) 0
+#define SET_OBJECT_OWNER(_o, _chunk_offset) 0
+#define is_scm_object(_ptr) 1
+#endif
+
+// the memory block returned by __real_malloc that contains the object
+#define OBJECT_CHUNK(_o) \
+    ((void*)(_o) - OBJECT_CHUNK_OFFSET(_o))
+// the payload bytes that are usable by the user
+#define OBJECT_USABLE_SIZE(_o) \
+    (__real_malloc_usable_size(OBJECT_CHUNK(_o)) - OBJECT_CHUNK_OFFSET(_o) \
+    - sizeof(object_header_t))
+
 #endif	/* _OBJECT_H_ */
\ No newline at end of file
@@ -0,0 +1,247 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "pool.h"
+
+#define ROUND_UP_TO(x, y) (((x) + ((y) - 1)) & ~((y) - 1))
+
+char *pool_arena = NULL;
+
+// bytes of the arena handed out as pool pages
+static size_t pool_arena_used = 0;
+
+//protects pool_arena and pool_arena_used
+static pthread_mutex_t pool_arena_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// pools without owner, waiting to be adopted
+static pool_t *orphaned_pools = NULL;
+
+//protects orphaned_pools
+static pthread_mutex_t orphaned_pools_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Reserves the address range of the pool pages, once. The pages are
+ * backed by physical memory when they are first written.
+ */
+static int reserve_pool_arena() {
+    if (pool_arena != NULL) return 0;
+
+    pthread_mutex_lock(&pool_arena_lock);
+
+    if (pool_arena == NULL) {
+        //reserve one more page to align the arena to the page size
+        char *arena = mmap(NULL, SCM_POOL_ARENA_SIZE + SCM_POOL_PAGE_SIZE,
+                PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+        if (arena != MAP_FAILED) {
+            pool_arena = (char*) ROUND_UP_TO((uintptr_t) arena,
+                    SCM_POOL_PAGE_SIZE);
+        }
+#ifdef SCM_DEBUG
+        else {
+            printf("Reservation of the pool arena failed.\n");
+        }
+#endif
+    }
+
+    pthread_mutex_unlock(&pool_arena_lock);
+
+    return pool_arena == NULL ? -1 : 0;
+}
+
+/**
+ * Returns a new pool page from the arena or NULL if the arena is exhausted.
+ */
+static pool_page_t *new_pool_page(pool_t *pool) {
+    pool_page_t *page = NULL;
+
+    pthread_mutex_lock(&pool_arena_lock);
+
+    if (pool_arena_used + SCM_POOL_PAGE_SIZE <= SCM_POOL_ARENA_SIZE) {
+        page = (pool_page_t*) (pool_arena + pool_arena_used);
+        pool_arena_used += SCM_POOL_PAGE_SIZE;
+    }
+
+    pthread_mutex_unlock(&pool_arena_lock);
+
+    if (page == NULL) {
+#ifdef SCM_DEBUG
+        printf("Pool arena exhausted.\n");
+#endif
+        return NULL;
+    }
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    inc_overhead(SCM_POOL_PAGE_SIZE);
+#endif
+
+    page->pool = pool;
+
+    return page;
+}
+
+/**
+ * Takes an orphaned pool with the given geometry off the list, or returns
+ * NULL if there is none.
+ */
+static pool_t *adopt_orphaned_pool(size_t slot_size, size_t first_slot) {
+    pool_t *pool = NULL;
+
+    pthread_mutex_lock(&orphaned_pools_lock);
+
+    pool_t **link = &orphaned_pools;
+
+    while (*link != NULL) {
+        if ((*link)->slot_size == slot_size
+                && (*link)->first_slot == first_slot) {
+            pool = *link;
+            *link = pool->next;
+            break;
+        }
+        link = &(*link)->next;
+    }
+
+    pthread_mutex_unlock(&orphaned_pools_lock);
+
+    return pool;
+}
+
+/**
+ * Returns a pool of the calling thread. The payload of every object is
+ * aligned to alignment and large enough to link the object into the free
+ * lists of the pool. An orphaned pool with the same slots is adopted
+ * together with its free objects and pages.
+ */
+pool_t *new_pool(size_t object_size, size_t alignment) {
+    if ((alignment & (alignment - 1)) != 0) return NULL;
+
+    if (alignment < sizeof(void*)) alignment = sizeof(void*);
+    if (object_size < sizeof(void*)) object_size = sizeof(void*);
+
+    if (alignment > SCM_POOL_PAGE_SIZE
+            || object_size > SCM_POOL_PAGE_SIZE) {
+        return NULL;
+    }
+
+    size_t first_slot = ROUND_UP_TO(sizeof(pool_page_t)
+            + sizeof(object_header_t), alignment) - sizeof(object_header_t);
+    size_t slot_size = ROUND_UP_TO(sizeof(object_header_t) + object_size,
+            alignment);
+
+    if (first_slot + slot_size > SCM_POOL_PAGE_SIZE) return NULL;
+
+    pool_t *pool = adopt_orphaned_pool(slot_size, first_slot);
+
+    if (pool != NULL) {
+        pool->object_size = object_size;
+        pool->next = NULL;
+        pool->owner = descriptor_root;
+
+        return pool;
+    }
+
+    if (reserve_pool_arena() != 0) return NULL;
+
+    pool = __real_malloc(sizeof(pool_t));
+
+    if (pool == NULL) return NULL;
+
+    pool->object_size = object_size;
+    pool->slot_size = slot_size;
+    pool->first_slot = first_slot;
+    pool->free_list = NULL;
+    pool->remote_free_list = NULL;
+    //the first allocation takes a new page
+    pool->next_free_slot = NULL;
+    pool->last_slot = NULL;
+    pool->owner = descriptor_root;
+    pool->next = NULL;
+
+    return pool;
+}
+
+/**
+ * Orphans a pool of the calling thread. Objects that expire afterwards, in
+ * any thread, are pushed to the remote free list of the pool.
+ */
+void orphan_pool(pool_t *pool) {
+    pool->owner = NULL;
+
+    pthread_mutex_lock(&orphaned_pools_lock);
+
+    pool->next = orphaned_pools;
+    orphaned_pools = pool;
+
+    pthread_mutex_unlock(&orphaned_pools_lock);
+}
+
+/**
+ * Returns a free object of the pool: an expired object of the owner,
+ * an object expired by another thread or the next slot of the last page.
+ */
+object_header_t *new_pool_object(pool_t *pool) {
+    object_header_t *object = pool->free_list;
+
+    if (object == NULL && pool->remote_free_list != NULL) {
+        object = atomic_pointer_exchange_acquire(
+                (void * volatile *) &pool->remote_free_list, NULL);
+    }
+
+    if (object != NULL) {
+        pool->free_list = *(object_header_t**) PAYLOAD_OFFSET(object);
+
+        return object;
+    }
+
+    if (pool->next_free_slot == NULL
+            || pool->next_free_slot > pool->last_slot) {
+        char *page = (char*) new_pool_page(pool);
+
+        if (page == NULL) return NULL;
+
+        pool->next_free_slot = page + pool->first_slot;
+        pool->last_slot = page + SCM_POOL_PAGE_SIZE - pool->slot_size;
+    }
+
+    object = (object_header_t*) pool->next_free_slot;
+    pool->next_free_slot += pool->slot_size;
+
+    return object;
+}
+
+/**
+ * Returns an object to its pool. Objects released by other threads than
+ * the owner of the pool, or to an orphaned pool, are pushed to the remote
+ * free list.
+ */
+void release_pool_object(object_header_t *object) {
+    pool_t *pool = POOL_PAGE(object)->pool;
+    object_header_t **next = (object_header_t**) PAYLOAD_OFFSET(object);
+
+    if (pool->owner == descriptor_root && descriptor_root != NULL) {
+        *next = pool->free_list;
+        pool->free_list = object;
+        return;
+    }
+
+    object_header_t *first = pool->remote_free_list;
+
+    for (;;) {
+        *next = first;
+
+        object_header_t *seen = atomic_pointer_compare_and_exchange_release(
+                (void * volatile *) &pool->remote_free_list, first, object);
+
+        if (seen == first) return;
+
+        first = seen;
+    }
+}
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+#ifndef _POOL_H_
+#define	_POOL_H_
+
+#include <stdint.h>
+
+#include "descriptors.h"
+
+/*
+ * Pool pages are SCM_POOL_PAGE_SIZE aligned blocks of an address range of
+ * SCM_POOL_ARENA_SIZE bytes, which is reserved when the first pool is
+ * created. Pool pages are never returned to the arena. Each page starts
+ * with a pointer to its pool, so an object is identified as pool object by
+ * its address and finds its pool without a lookup.
+ */
+typedef struct pool_page pool_page_t;
+
+struct pool_page {
+    pool_t *pool;
+};
+
+#define POOL_PAGE(_o) \
+    ((pool_page_t*) ((uintptr_t) (_o) & ~((uintptr_t) SCM_POOL_PAGE_SIZE - 1)))
+
+// start of the reserved address range, NULL until the first pool exists
+extern char *pool_arena __attribute__((visibility("hidden")));
+
+/**
+ * is_pool_object() returns non-zero if the object was allocated from a pool.
+ */
+static inline int is_pool_object(void *object) {
+    return pool_arena != NULL
+        && (uintptr_t) object - (uintptr_t) pool_arena < SCM_POOL_ARENA_SIZE;
+}
+
+/* Returns the usable payload size of a pool object */
+static inline size_t pool_object_size(object_header_t *object) {
+    return POOL_PAGE(object)->pool->slot_size - sizeof(object_header_t);
+}
+
+/* Returns a pool of the calling thread, an adopted orphaned pool or a new
+ * one, or NULL if the parameters are invalid */
+pool_t *new_pool(size_t object_size, size_t alignment)
+    __attribute__((visibility("hidden")));
+
+/* Gives up the ownership of a pool, which keeps its objects and pages */
+void orphan_pool(pool_t *pool)
+    __attribute__((visibility("hidden")));
+
+/* Returns the header of a free object of the pool or NULL */
+object_header_t *new_pool_object(pool_t *pool)
+    __attribute__((visibility("hidden")));
+
+/* Returns an object without descriptors to its pool */
+void release_pool_object(object_header_t *object)
+    __attribute__((visibility("hidden")));
+
+#endif	/* _POOL_H_ */
@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+#ifdef SCM_PRELOAD
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <sys/mman.h>
+
+#include "object.h"
+#include "preload.h"
+
+/*
+ * Entry points of the glibc allocator, which are not interposed by
+ * LD_PRELOAD. They replace the __real_* symbols of the -Wl,--wrap build.
+ */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nelem, size_t elsize);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void __libc_free(void *ptr);
+
+__attribute__((visibility("hidden")))
+void *__real_malloc(size_t size) {
+    return __libc_malloc(size);
+}
+
+__attribute__((visibility("hidden")))
+void *__real_calloc(size_t nelem, size_t elsize) {
+    return __libc_calloc(nelem, elsize);
+}
+
+__attribute__((visibility("hidden")))
+void *__real_realloc(void *ptr, size_t size) {
+    return __libc_realloc(ptr, size);
+}
+
+__attribute__((visibility("hidden")))
+void __real_free(void *ptr) {
+    __libc_free(ptr);
+}
+
+/**
+ * glibc has no __libc_malloc_usable_size, so the next definition of
+ * malloc_usable_size after libscm is looked up on first use. dlsym may
+ * allocate, which is fine because malloc does not depend on this function.
+ */
+__attribute__((visibility("hidden")))
+size_t __real_malloc_usable_size(void *ptr) {
+    static size_t (*libc_malloc_usable_size)(void*) = NULL;
+
+    if (libc_malloc_usable_size == NULL) {
+        libc_malloc_usable_size = dlsym(RTLD_NEXT, "malloc_usable_size");
+    }
+    return libc_malloc_usable_size(ptr);
+}
+
+/*
+ * Two-level ownership bitmap. The root is zero-initialized static memory,
+ * leaves are mapped on demand and never unmapped. Bits are never cleared:
+ * a page once used for an object header remains a candidate, the owner tag
+ * of the header decides.
+ */
+static unsigned long *owned_pages[1UL << SCM_OWNER_ROOT_BITS];
+
+#define OWNER_BITS_PER_WORD (8 * sizeof(unsigned long))
+#define OWNER_LEAF_SIZE \
+    ((1UL << SCM_OWNER_LEAF_BITS) / OWNER_BITS_PER_WORD \
+    * sizeof(unsigned long))
+
+static unsigned long *get_owner_leaf(uintptr_t page, int create) {
+    uintptr_t root_index = page >> SCM_OWNER_LEAF_BITS;
+
+    if (root_index >= (1UL << SCM_OWNER_ROOT_BITS)) {
+        return NULL;
+    }
+
+    unsigned long *leaf = owned_pages[root_index];
+
+    if (leaf != NULL || !create) {
+        return leaf;
+    }
+
+    leaf = mmap(NULL, OWNER_LEAF_SIZE, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (leaf == MAP_FAILED) {
+        return NULL;
+    }
+
+    if (!__sync_bool_compare_and_swap(&owned_pages[root_index], NULL, leaf)) {
+        //another thread installed the leaf first
+        munmap(leaf, OWNER_LEAF_SIZE);
+        leaf = owned_pages[root_index];
+    }
+
+    return leaf;
+}
+
+/**
+ * mark_owned_page() records the page of an object header written by libscm.
+ * Returns -1 if the page is outside of the covered address space or the
+ * leaf of the bitmap could not be mapped. The object would not be
+ * recognized as owned by libscm then, so the caller must not hand it out.
+ */
+int mark_owned_page(void *object) {
+    uintptr_t page = (uintptr_t) object >> SCM_OWNER_PAGE_BITS;
+    unsigned long *leaf = get_owner_leaf(page, 1);
+
+    if (leaf == NULL) {
+        return -1;
+    }
+
+    uintptr_t bit = page & ((1UL << SCM_OWNER_LEAF_BITS) - 1);
+    unsigned long mask = 1UL << (bit % OWNER_BITS_PER_WORD);
+    unsigned long *word = &leaf[bit / OWNER_BITS_PER_WORD];
+
+    //avoid the atomic operation on the common path of an already marked page
+    if ((*word & mask) == 0) {
+        __sync_fetch_and_or(word, mask);
+    }
+
+    return 0;
+}
+
+/**
+ * is_owned_page() returns non-zero if the page of the object header may
+ * contain a header written by libscm.
+ */
+int is_owned_page(void *object) {
+    uintptr_t page = (uintptr_t) object >> SCM_OWNER_PAGE_BITS;
+    unsigned long *leaf = get_owner_leaf(page, 0);
+
+    if (leaf == NULL) return 0;
+
+    uintptr_t bit = page & ((1UL << SCM_OWNER_LEAF_BITS) - 1);
+
+    return (leaf[bit / OWNER_BITS_PER_WORD]
+            >> (bit % OWNER_BITS_PER_WORD)) & 1;
+}
+
+#endif  /* SCM_PRELOAD */
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+#ifndef _PRELOAD_H_
+#define	_PRELOAD_H_
+
+#ifdef SCM_PRELOAD
+
+#include <stdint.h>
+
+/*
+ * The preloadable libscm (make preload, dist/libscm-preload.so) defines
+ * malloc, free, calloc, realloc, malloc_usable_size and the memalign family
+ * directly instead of relying on -Wl,--wrap at link time. The underlying
+ * allocator is reached through the __libc_* entry points of glibc.
+ *
+ * Pointers that were not allocated by libscm (e.g. allocated by the dynamic
+ * loader before libscm was loaded or by another allocator) are detected
+ * and forwarded to the underlying allocator. Ownership is decided in two
+ * steps: a page-granular bitmap records every page that contains an object
+ * header written by libscm, and the header of an object on such a page must
+ * carry an owner tag derived from its address (see OBJECT_TAG).
+ *
+ * Nothing in this module uses stdio or pthreads and the bitmap is allocated
+ * with mmap, so it is safe to run before libc is fully initialized.
+ */
+
+// bits of an address covered by the ownership bitmap
+#define SCM_OWNER_ADDRESS_BITS 48
+#define SCM_OWNER_PAGE_BITS 12
+// every leaf of the bitmap covers 2^SCM_OWNER_LEAF_BITS pages
+#define SCM_OWNER_LEAF_BITS 20
+#define SCM_OWNER_ROOT_BITS \
+    (SCM_OWNER_ADDRESS_BITS - SCM_OWNER_PAGE_BITS - SCM_OWNER_LEAF_BITS)
+
+int mark_owned_page(void *object) __attribute__((visibility("hidden")));
+
+int is_owned_page(void *object) __attribute__((visibility("hidden")));
+
+#endif  /* SCM_PRELOAD */
+
+#endif	/* _PRELOAD_H_ */
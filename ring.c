@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+#include <pthread.h>
+
+#include "ring.h"
+
+// records are word aligned like the objects of regions
+#define RECORD_SIZE(x) (((x) + 7) & ~((size_t) 7))
+
+ring_t rings[SCM_MAX_RINGS];
+
+//protects the allocation of entries in rings
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * Creates a ring of at least bytes bytes for the clock of the calling
+ * thread. The ring is linked into the list of rings of the thread.
+ */
+int create_ring(size_t bytes, const unsigned int clock, bool spsc) {
+    size_t size = 64;
+
+    while (size < bytes) {
+        if (size > SIZE_MAX / 2) return -1;
+        size *= 2;
+    }
+
+    char *buffer = __real_malloc(size);
+
+    if (buffer == NULL) {
+#ifdef SCM_DEBUG
+        printf("Memory for ring buffer could not be allocated.\n");
+#endif
+        return -1;
+    }
+
+    pthread_mutex_lock(&rings_lock);
+
+    int i;
+
+    for (i = 0; i < SCM_MAX_RINGS; i++) {
+        if (rings[i].buffer == NULL) break;
+    }
+
+    if (i == SCM_MAX_RINGS) {
+        pthread_mutex_unlock(&rings_lock);
+        __real_free(buffer);
+#ifdef SCM_DEBUG
+        printf("Ring contingency exceeded.\n");
+#endif
+        return -1;
+    }
+
+    ring_t *ring = &rings[i];
+
+    ring->buffer = buffer;
+    ring->size = size;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->mark = 0;
+    ring->clock = clock;
+    ring->spsc = spsc;
+    ring->owner = descriptor_root;
+
+    pthread_mutex_unlock(&rings_lock);
+
+    ring->next = descriptor_root->rings;
+    descriptor_root->rings = ring;
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    inc_overhead(__real_malloc_usable_size(buffer));
+#endif
+
+    return i;
+}
+
+/**
+ * Appends a record of size bytes (without object header) to the ring.
+ */
+object_header_t *new_ring_object(ring_t *ring, size_t size) {
+    size_t needed_space = RECORD_SIZE(size + sizeof(object_header_t));
+
+    if (size > ring->size || needed_space > ring->size) return NULL;
+
+    long head = ring->head;
+    long tail = ring->spsc ?
+        atomic_long_load_acquire(&ring->tail) : ring->tail;
+    size_t offset = head & (ring->size - 1);
+
+    //a record never wraps around the end of the buffer
+    if (offset + needed_space > ring->size) {
+        head += ring->size - offset;
+        offset = 0;
+    }
+
+    if ((size_t) (head + needed_space - tail) > ring->size) {
+#ifdef SCM_DEBUG
+        printf("Ring buffer is full.\n");
+#endif
+        return NULL;
+    }
+
+    object_header_t *object = (object_header_t*) (ring->buffer + offset);
+
+    if (ring->spsc) {
+        atomic_long_store_release(&ring->head, head + needed_space);
+    } else {
+        ring->head = head + needed_space;
+    }
+
+    object->dc_or_region_id = TICK_ARENA_OBJECT;
+    object->finalizer_index = needed_space - sizeof(object_header_t);
+
+    return object;
+}
+
+/**
+ * Releases the records allocated before the previous tick of the clock.
+ */
+void tick_rings(const unsigned int clock) {
+    ring_t *ring;
+
+    for (ring = descriptor_root->rings; ring != NULL; ring = ring->next) {
+        if (ring->clock != clock) continue;
+
+        if (ring->spsc) {
+            atomic_long_store_release(&ring->tail, ring->mark);
+            ring->mark = atomic_long_load_acquire(&ring->head);
+        } else {
+            ring->tail = ring->mark;
+            ring->mark = ring->head;
+        }
+    }
+}
+
+/**
+ * Destroys a ring of the calling thread, the records of the ring must not
+ * be used anymore.
+ */
+void destroy_ring(ring_t *ring) {
+    ring_t **link = &descriptor_root->rings;
+
+    while (*link != ring) {
+        link = &(*link)->next;
+    }
+    *link = ring->next;
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    dec_overhead(__real_malloc_usable_size(ring->buffer));
+#endif
+
+    __real_free(ring->buffer);
+
+    pthread_mutex_lock(&rings_lock);
+    ring->buffer = NULL;
+    pthread_mutex_unlock(&rings_lock);
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+#ifndef _RING_H_
+#define	_RING_H_
+
+#include <stdbool.h>
+
+#include "descriptors.h"
+
+/*
+ * A ring buffer allocates variable-size records, i.e. objects with an
+ * object header, in allocation order from a circular buffer. head and tail
+ * count the bytes ever allocated and released, so head - tail bytes are in
+ * use. Every tick of the clock of the ring releases the records allocated
+ * before the previous tick (tail = mark) and remembers the current head
+ * (mark = head), so a record lives until the clock ticked twice.
+ *
+ * Records that do not fit at the end of the buffer start at the beginning,
+ * the remaining bytes are skipped. Records carry TICK_ARENA_OBJECT as
+ * descriptor counter and are never refreshed or freed individually.
+ *
+ * The thread that creates the ring owns it: its ticks advance the tail.
+ * In SPSC mode one other thread may allocate from the ring, head and tail
+ * are then published with release and read with acquire order.
+ */
+typedef struct ring ring_t;
+
+struct ring {
+    // NULL if the ring is unused
+    char *buffer;
+    // a power of two
+    size_t size;
+
+    volatile long head;
+    volatile long tail;
+    long mark;
+
+    unsigned int clock;
+    bool spsc;
+
+    struct descriptor_root *owner;
+    // next ring of the owner
+    ring_t *next;
+};
+
+extern ring_t rings[SCM_MAX_RINGS] __attribute__((visibility("hidden")));
+
+/* Creates a ring owned by the calling thread, returns its index or -1 */
+int create_ring(size_t bytes, const unsigned int clock, bool spsc)
+    __attribute__((visibility("hidden")));
+
+/* Returns the header of a new record or NULL if the ring is full */
+object_header_t *new_ring_object(ring_t *ring, size_t size)
+    __attribute__((visibility("hidden")));
+
+/* Advances the rings of the calling thread that use the clock */
+void tick_rings(const unsigned int clock)
+    __attribute__((visibility("hidden")));
+
+/* Unlinks the ring from its owner and frees its buffer */
+void destroy_ring(ring_t *ring)
+    __attribute__((visibility("hidden")));
+
+#endif	/* _RING_H_ */
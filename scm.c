@@ -13,8 +13,22 @@
  */
 void *__wrap_malloc(size_t size) {
 
-    object_header_t* object =
-        (object_header_t*) (__real_malloc(size + sizeof(object_header_t)));
+    if (size > SIZE_MAX - sizeof(object_header_t)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    object_header_t* object = NULL;
+
+    //reuse the block of an expired object of the same size class
+    if (descriptor_root != NULL) {
+        object = recycled_object(size + sizeof(object_header_t));
+    }
+
+    if (object == NULL) {
+        object = (object_header_t*)
+            (__real_malloc(size + sizeof(object_header_t)));
+    }
 
     if (!object) {
 #ifdef SCM_DEBUG
@@ -25,6 +39,11 @@ void *__wrap_malloc(size_t size) {
 
     object->dc_or_region_id = 0;
     object->finalizer_index = -1;
+    if (SET_OBJECT_OWNER(object, 0) != 0) {
+        __real_free(object);
+        errno = ENOMEM;
+        return NULL;
+    }
 
 #ifdef SCM_RECORD_MEMORY_USAGE
     inc_overhead(sizeof(object_header_t));
@@ -43,12 +62,47 @@ extern __typeof__(__wrap_malloc) __wrap_malloc_internal
 
 void *__wrap_calloc(size_t nelem, size_t elsize) {
 
+    if (elsize != 0 && nelem > SIZE_MAX / elsize) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
     void *p = __wrap_malloc_internal(nelem * elsize);
+
+    if (p == NULL) return NULL;
+
     //calloc returns zeroed memory by specification
     memset(p, '\0', nelem * elsize);
     return p;
 }
 
+/**
+ * release_pin() removes the pin of an object and returns non-zero if the
+ * object has no descriptors left, i.e. the caller has to free it.
+ */
+static inline int release_pin(object_header_t *object) {
+    return atomic_int_exchange_and_add_acq_rel(
+            &object->dc_or_region_id, -PINNED_BIAS) == PINNED_BIAS;
+}
+
+/**
+ * free_object() returns the memory of an object without descriptors to its
+ * pool or to the underlying allocator.
+ */
+static inline void free_object(object_header_t *object) {
+    if (is_pool_object(object)) {
+        release_pool_object(object);
+        return;
+    }
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    dec_overhead(sizeof(object_header_t));
+    inc_freed_mem(__real_malloc_usable_size(OBJECT_CHUNK(object)));
+#endif
+
+    __real_free(OBJECT_CHUNK(object));
+}
+
 /**
  * Reallocates memory, e.g. with ptmalloc2, and
  * wraps object header around requested memory.
@@ -56,9 +110,12 @@ void *__wrap_calloc(size_t nelem, size_t elsize) {
 void *__wrap_realloc(void *ptr, size_t size) {
 
     if (ptr == NULL) return __wrap_malloc_internal(size);
+
+    if (!is_scm_object(ptr)) return __real_realloc(ptr, size);
+
     //else: create new object
     object_header_t* new_object =
-        (object_header_t*) __real_malloc(size + sizeof(object_header_t));
+        (object_header_t*) __wrap_malloc_internal(size);
 
     if (!new_object) {
 #ifdef SCM_DEBUG
@@ -66,17 +123,20 @@ void *__wrap_realloc(void *ptr, size_t size) {
 #endif
         return NULL;
     }
-    new_object->dc_or_region_id = 0;
-    new_object->finalizer_index = -1;
+    new_object = OBJECT_HEADER((void*) new_object);
 
-#ifdef SCM_RECORD_MEMORY_USAGE
-    inc_overhead(sizeof(object_header_t));
-#endif
+    object_header_t* old_object = OBJECT_HEADER(ptr);
 
     //get the minimum of the old size and the new size
-    size_t old_object_size =
-        __real_malloc_usable_size(OBJECT_HEADER(ptr))
-        - sizeof (object_header_t);
+    size_t old_object_size;
+
+    if (old_object->dc_or_region_id == TICK_ARENA_OBJECT) {
+        old_object_size = old_object->finalizer_index;
+    } else if (is_pool_object(old_object)) {
+        old_object_size = pool_object_size(old_object);
+    } else {
+        old_object_size = OBJECT_USABLE_SIZE(old_object);
+    }
     size_t lesser_object_size;
 
     if (old_object_size >= size) {
@@ -85,27 +145,26 @@ void *__wrap_realloc(void *ptr, size_t size) {
         lesser_object_size = old_object_size;
     }
 
-    object_header_t* old_object = OBJECT_HEADER(ptr);
     //copy payload bytes 0..(lesser_size-1) from the old object to the new one
     memcpy(PAYLOAD_OFFSET(new_object),
            PAYLOAD_OFFSET(old_object),
            lesser_object_size);
 
-    if (old_object->dc_or_region_id == 0) {
-        //if the old object has no descriptors, we can free it
+    int old_dc = old_object->dc_or_region_id;
 
-#ifdef SCM_RECORD_MEMORY_USAGE
-        inc_freed_mem(__real_malloc_usable_size(old_object));
-        dec_overhead(sizeof(object_header_t));
-#endif
+    if (old_dc == TICK_ARENA_OBJECT) {
+        //the old object is released with its tick arena
+    } else if (old_dc >= PINNED_BIAS) {
+        //the new object takes over the pin of the old object
+        new_object->dc_or_region_id = PINNED_BIAS;
 
-        __real_free(old_object);
-    } //else: the old object will be freed later due to expiration
+        old_dc = release_pin(old_object) ? 0 : 1;
+    }
 
-#ifdef SCM_RECORD_MEMORY_USAGE
-    inc_allocated_mem(__real_malloc_usable_size(new_object));
-    print_memory_consumption();
-#endif
+    if (old_dc == 0) {
+        //if the old object has no descriptors, we can free it
+        free_object(old_object);
+    } //else: the old object will be freed later due to expiration
 
     return PAYLOAD_OFFSET(new_object);
 }
@@ -117,20 +176,34 @@ void __wrap_free(void *ptr) {
 
     if (ptr == NULL) return;
 
+    if (!is_scm_object(ptr)) {
+        //not allocated by libscm, e.g. before libscm was preloaded
+        __real_free(ptr);
+        return;
+    }
+
     object_header_t* object = OBJECT_HEADER(ptr);
 
-    if (object->dc_or_region_id == 0) {
-#ifdef SCM_RECORD_MEMORY_USAGE
-        dec_overhead(sizeof(object_header_t));
-        inc_freed_mem(__real_malloc_usable_size(object));
-#endif
+    int dc = object->dc_or_region_id;
 
-        __real_free(object);
+    //released with its tick arena
+    if (dc == TICK_ARENA_OBJECT) return;
+
+    if (dc >= PINNED_BIAS) {
+        //a pinned object is unpinned and freed now or, if it still has
+        //descriptors, when its last descriptor expires
+        if (!release_pin(object)) return;
+
+        dc = 0;
+    }
+
+    if (dc == 0) {
+        free_object(object);
     } else {
 #ifdef SCM_DEBUG
-        if(object->dc_or_region_id > 0) {
+        if(dc > 0) {
             printf("Cannot free objects which are still referenced.\n");
-        } else if(object->dc_or_region_id < 0) {
+        } else if(dc < 0) {
             printf("Cannot free single objects from a region.\n");
         }
 #endif
@@ -146,47 +219,229 @@ extern __typeof__(__wrap_free) __wrap_free_internal
  */
 size_t __wrap_malloc_usable_size(void *ptr) {
 
-    object_header_t* object = OBJECT_HEADER(ptr);
+    if (ptr == NULL) return 0;
+
+    if (!is_scm_object(ptr)) return __real_malloc_usable_size(ptr);
+
+    object_header_t *object = OBJECT_HEADER(ptr);
+
+    if (object->dc_or_region_id == TICK_ARENA_OBJECT) {
+        return object->finalizer_index;
+    }
+
+    if (is_pool_object(object)) return pool_object_size(object);
+
+    return OBJECT_USABLE_SIZE(object);
+}
+
+#ifdef SCM_PRELOAD
+/**
+ * Allocates an object whose payload is aligned to alignment, which must be
+ * a power of two. The object header is placed right before the payload and
+ * remembers its offset to the beginning of the allocated chunk.
+ */
+static void *scm_memalign(size_t alignment, size_t size) {
+
+    if (alignment <= sizeof(object_header_t)) {
+        //the payload of every object is 16-byte aligned
+        return __wrap_malloc_internal(size);
+    }
+
+    if (size > SIZE_MAX - alignment - sizeof(object_header_t)) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    void *chunk =
+        __real_malloc(size + alignment + sizeof(object_header_t));
+
+    if (!chunk) {
+#ifdef SCM_DEBUG
+        printf("memalign failed.\n");
+#endif
+        return NULL;
+    }
+
+    void *payload = (void*) ROUND_UP((uintptr_t) chunk
+            + sizeof(object_header_t), (uintptr_t) alignment);
+    object_header_t* object = OBJECT_HEADER(payload);
+
+    object->dc_or_region_id = 0;
+    object->finalizer_index = -1;
+    if (SET_OBJECT_OWNER(object, (void*) object - chunk) != 0) {
+        __real_free(chunk);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    inc_overhead(sizeof(object_header_t));
+    inc_allocated_mem(__real_malloc_usable_size(chunk));
+
+    print_memory_consumption();
+#endif
+
+    return payload;
+}
 
-    return __real_malloc_usable_size(object) - sizeof(object_header_t);
+static inline int is_power_of_two(size_t x) {
+    return x != 0 && (x & (x - 1)) == 0;
 }
 
+void *__wrap_memalign(size_t alignment, size_t size) {
+
+    if (!is_power_of_two(alignment)) {
+        errno = EINVAL;
+        return NULL;
+    }
+    return scm_memalign(alignment, size);
+}
+
+int __wrap_posix_memalign(void **memptr, size_t alignment, size_t size) {
+
+    if (!is_power_of_two(alignment) || alignment % sizeof(void*) != 0) {
+        return EINVAL;
+    }
+
+    void *p = scm_memalign(alignment, size);
+
+    if (p == NULL) return ENOMEM;
+
+    *memptr = p;
+    return 0;
+}
+
+void *__wrap_aligned_alloc(size_t alignment, size_t size) {
+    return __wrap_memalign(alignment, size);
+}
+
+void *__wrap_valloc(size_t size) {
+    return scm_memalign(sysconf(_SC_PAGESIZE), size);
+}
+
+void *__wrap_pvalloc(size_t size) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+
+    if (size > SIZE_MAX - page_size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return scm_memalign(page_size, ROUND_UP(size, page_size));
+}
+
+//the preloadable library defines the allocator functions itself
+extern __typeof__(__wrap_malloc) malloc
+    __attribute__((alias("__wrap_malloc"), visibility("default")));
+extern __typeof__(__wrap_calloc) calloc
+    __attribute__((alias("__wrap_calloc"), visibility("default")));
+extern __typeof__(__wrap_realloc) realloc
+    __attribute__((alias("__wrap_realloc"), visibility("default")));
+extern __typeof__(__wrap_free) free
+    __attribute__((alias("__wrap_free"), visibility("default")));
+extern __typeof__(__wrap_malloc_usable_size) malloc_usable_size
+    __attribute__((alias("__wrap_malloc_usable_size"), visibility("default")));
+extern __typeof__(__wrap_memalign) memalign
+    __attribute__((alias("__wrap_memalign"), visibility("default")));
+extern __typeof__(__wrap_posix_memalign) posix_memalign
+    __attribute__((alias("__wrap_posix_memalign"), visibility("default")));
+extern __typeof__(__wrap_aligned_alloc) aligned_alloc
+    __attribute__((alias("__wrap_aligned_alloc"), visibility("default")));
+extern __typeof__(__wrap_valloc) valloc
+    __attribute__((alias("__wrap_valloc"), visibility("default")));
+extern __typeof__(__wrap_pvalloc) pvalloc
+    __attribute__((alias("__wrap_pvalloc"), visibility("default")));
+#endif
+
 // The descriptor root is stored as thread-local storage variable.
 // According to perf tools from Google __thread is faster than
 // pthread_getspecific().
 __thread descriptor_root_t* descriptor_root __attribute__((tls_model("initial-exec")));
 
-static descriptor_root_t *terminated_descriptor_roots = NULL;
+// heaps[0] is the default heap, the others are created by scm_heap_create
+static scm_heap_t heaps[SCM_MAX_HEAPS] = {
+    [0] = {
+        .ticked_threads_countdown = 1,
+        .global_time_lock = PTHREAD_MUTEX_INITIALIZER,
+        .terminated_descriptor_roots_lock = PTHREAD_MUTEX_INITIALIZER,
+        .max_extension = SCM_MAX_EXPIRATION_EXTENSION,
+        .max_clocks = SCM_MAX_CLOCKS,
+        .index = 0,
+        .used = true
+    }
+};
+
+//protects the allocation of entries in heaps
+static pthread_mutex_t heaps_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Lifetime classes of the process. Classes are never removed. The
+ * parameters of a class are stored before its version is incremented, so a
+ * thread that sees a version also sees the parameters of that version or
+ * newer ones.
+ */
+typedef struct lifetime_class lifetime_class_t;
+
+struct lifetime_class {
+    char *name;
+    volatile long extension;
+    volatile long clock;
+    // 0 for unregistered classes
+    volatile long version;
+};
+
+static lifetime_class_t lifetime_classes[SCM_MAX_LIFETIME_CLASSES];
+
+static int number_of_lifetime_classes;
+
+//protects the registration and the versions of lifetime classes
+static pthread_mutex_t lifetime_classes_lock = PTHREAD_MUTEX_INITIALIZER;
 
-//protects the data structures of terminated threads
-static pthread_mutex_t terminated_descriptor_roots_lock = PTHREAD_MUTEX_INITIALIZER;
+static void invalidate_lifetime_classes(void);
+
+#ifdef SCM_MEMORY_BUDGETS
+static void charge_leases(const unsigned int clock);
+#endif
+
+// The current heap of the thread, NULL for the default heap, and the
+// descriptor roots of the thread in all heaps, indexed by heap index.
+static __thread scm_heap_t *current_heap __attribute__((tls_model("initial-exec")));
+static __thread descriptor_root_t *heap_roots[SCM_MAX_HEAPS] __attribute__((tls_model("initial-exec")));
+
+static inline scm_heap_t *this_heap() {
+    return current_heap != NULL ? current_heap : &heaps[0];
+}
+
+/* Returns true if the clock exists in the current heap of the thread */
+static inline bool valid_clock(const unsigned int clock) {
+    return clock < this_heap()->max_clocks;
+}
 
 /**
- * lock_descriptor_roots() locks the descriptor roots.
+ * lock_descriptor_roots() locks the descriptor roots of a heap.
  */
-static inline void lock_descriptor_roots() {
+static inline void lock_descriptor_roots(scm_heap_t *heap) {
 #ifdef SCM_PRINT_BLOCKING
-    if (pthread_mutex_trylock(&terminated_descriptor_roots_lock)) {
+    if (pthread_mutex_trylock(&heap->terminated_descriptor_roots_lock)) {
         printf("Thread %p BLOCKS on terminated_descriptor_roots_lock.\n", (void*) pthread_self());
-        pthread_mutex_lock(&terminated_descriptor_roots_lock);
+        pthread_mutex_lock(&heap->terminated_descriptor_roots_lock);
     }
 #else
-    pthread_mutex_lock(&terminated_descriptor_roots_lock);
+    pthread_mutex_lock(&heap->terminated_descriptor_roots_lock);
 #endif
 }
 
 /**
  * unlock_descriptor_roots() releases the lock of the descriptor roots.
  */
-static inline void unlock_descriptor_roots() {
-    pthread_mutex_unlock(&terminated_descriptor_roots_lock);
+static inline void unlock_descriptor_roots(scm_heap_t *heap) {
+    pthread_mutex_unlock(&heap->terminated_descriptor_roots_lock);
 }
 
 /**
  * new_descriptor_root() allocates space for the descriptor_root and
  * initializes its data.
  */
-static descriptor_root_t* new_descriptor_root() {
+static descriptor_root_t* new_descriptor_root(scm_heap_t *heap) {
 
     //allocate descriptor_root 0 initialized
     descriptor_root_t *descriptor_root =
@@ -210,40 +465,31 @@ static descriptor_root_t* new_descriptor_root() {
 
     descriptor_root->round_robin = 1;
     descriptor_root->blocked = true;
+    descriptor_root->heap = heap;
 
     return descriptor_root;
 }
 
-static long global_time = 0;
-
-//the number of threads registered for global time advance
-static unsigned int number_of_threads = 0;
-
-//the number of threads, that have not yet ticked in a global period
-static unsigned int ticked_threads_countdown = 1;
-
-//protects global_time, number_of_threads, and ticked_threads_countdown
-static pthread_mutex_t global_time_lock = PTHREAD_MUTEX_INITIALIZER;
-
 /**
- * lock_global_time() uses a pthread mutex to lock the global time variable.
+ * lock_global_time() uses a pthread mutex to lock the global time variable
+ * of a heap.
  */
-static inline void lock_global_time() {
+static inline void lock_global_time(scm_heap_t *heap) {
 #ifdef SCM_PRINT_BLOCKING
-    if (pthread_mutex_trylock(&global_time_lock)) {
+    if (pthread_mutex_trylock(&heap->global_time_lock)) {
         printf("Thread %p BLOCKS on global_time_lock.\n", (void*) pthread_self());
-        pthread_mutex_lock(&global_time_lock);
+        pthread_mutex_lock(&heap->global_time_lock);
     }
 #else
-    pthread_mutex_lock(&global_time_lock);
+    pthread_mutex_lock(&heap->global_time_lock);
 #endif
 }
 
 /**
  * unlock_global_time() releases the mutex for the global time variable.
  */
-static inline void unlock_global_time() {
-    pthread_mutex_unlock(&global_time_lock);
+static inline void unlock_global_time(scm_heap_t *heap) {
+    pthread_mutex_unlock(&heap->global_time_lock);
 }
 
 /**
@@ -262,22 +508,26 @@ void scm_block_thread() {
         return;
     }
 
+    scm_heap_t *heap = descriptor_root->heap;
+
     //assert: we do not have the descriptor_roots lock
-    lock_global_time();
-    number_of_threads--;
+    lock_global_time(heap);
+    heap->number_of_threads--;
     
     //decrement ticked_threads_countdown so other threads do not have to wait
-    if (global_time == descriptor_root->global_phase) {
+    if (heap->global_time == descriptor_root->global_phase) {
         //we have not ticked in this global period
-        if (atomic_int_dec_and_test((int*) &ticked_threads_countdown)) {
+        if (atomic_int_dec_and_test((int*) &heap->ticked_threads_countdown)) {
             //we are the last thread to tick and therefore need to tick globally
-            if (number_of_threads == 0) {
-                ticked_threads_countdown = 1;
+            if (heap->number_of_threads == 0) {
+                heap->ticked_threads_countdown = 1;
             } else {
-                ticked_threads_countdown = number_of_threads;
+                heap->ticked_threads_countdown = heap->number_of_threads;
             }
 
-            global_time++;
+            //global_time is read without the lock in scm_global_tick
+            atomic_long_store_release(&heap->global_time,
+                    heap->global_time + 1);
         } else {
             //there are other threads to tick before global time advances
         }
@@ -285,7 +535,7 @@ void scm_block_thread() {
         //we have already ticked globally in this global phase.
     }
 
-    unlock_global_time();
+    unlock_global_time(heap);
 
     descriptor_root->blocked = true;
 }
@@ -310,25 +560,27 @@ void scm_resume_thread() {
         return;
     }
 
+    scm_heap_t *heap = descriptor_root->heap;
+
     //assert: we do not have the descriptor_roots lock
-    lock_global_time();
+    lock_global_time(heap);
 
-    if (number_of_threads == 0) {
+    if (heap->number_of_threads == 0) {
         /* if this is the first thread to resume/register,
          * then we have to tick to make
          * global progress, unless another thread registers
          * assert: ticked_threads_countdown == 1
          */
-        descriptor_root->global_phase = global_time;
+        descriptor_root->global_phase = heap->global_time;
     } else {
         //else: we do not tick globally in the current global period
         //to avoid decrement of the ticked_threads_countdown
-        descriptor_root->global_phase = global_time + 1;
+        descriptor_root->global_phase = heap->global_time + 1;
     }
 
-    number_of_threads++;
+    heap->number_of_threads++;
 
-    unlock_global_time();
+    unlock_global_time(heap);
 
     descriptor_root->blocked = false;
 }
@@ -342,13 +594,15 @@ extern __typeof__(scm_resume_thread) scm_resume_thread_internal
  * terminated threads.
  */
 void register_thread() {
-    lock_descriptor_roots();
+    scm_heap_t *heap = this_heap();
+
+    lock_descriptor_roots(heap);
 
-    if (terminated_descriptor_roots != NULL) {
-        descriptor_root = terminated_descriptor_roots;
-        terminated_descriptor_roots = terminated_descriptor_roots->next;
+    if (heap->terminated_descriptor_roots != NULL) {
+        descriptor_root = heap->terminated_descriptor_roots;
+        heap->terminated_descriptor_roots = descriptor_root->next;
     } else {
-        descriptor_root = new_descriptor_root();
+        descriptor_root = new_descriptor_root(heap);
 
 #ifdef SCM_CHECK_CONDITIONS
         if(descriptor_root->round_robin != 1) {
@@ -369,7 +623,25 @@ void register_thread() {
     descriptor_root->locally_clocked_obj_buffer[0].age = current_time;
     descriptor_root->locally_clocked_reg_buffer[0].age = current_time;
     
-    unlock_descriptor_roots();
+    unlock_descriptor_roots(heap);
+
+    //the clocks of a terminated thread are not registered anymore
+    invalidate_lifetime_classes();
+
+#ifdef SCM_MEMORY_BUDGETS
+    //budgets are set per thread, the usage of a reused descriptor root
+    //still counts the descriptors of the terminated thread until they expire
+    int clock;
+
+    for (clock = 0; clock < SCM_MAX_CLOCKS; clock++) {
+        descriptor_root->clock_budgets[clock].limit = 0;
+        descriptor_root->clock_budgets[clock].policy = SCM_BUDGET_TICK;
+    }
+    descriptor_root->thread_budget.limit = 0;
+    descriptor_root->thread_budget.policy = SCM_BUDGET_TICK;
+#endif
+
+    heap_roots[heap->index] = descriptor_root;
 
     //assert: if descriptor_root belonged to a terminated thread,
     //block_thread was invoked on this thread
@@ -382,18 +654,63 @@ void register_thread() {
  * by other threads upon their creation.
  */
 static void unregister_thread(void* key_variable) {
-    if (descriptor_root != NULL) {
-        scm_block_thread_internal();
+    unsigned int i;
+
+    //leave every heap the thread used
+    for (i = 0; i < SCM_MAX_HEAPS; i++) {
+        descriptor_root = heap_roots[i];
+
+        if (descriptor_root == NULL) continue;
+
+        scm_heap_t *heap = descriptor_root->heap;
+
+        //a thread parked in another heap is blocked already
+        if (!descriptor_root->blocked) {
+            scm_block_thread_internal();
+        }
+        descriptor_root->parked = false;
+
+        //blocks of a terminated thread go back to the allocator
+        flush_recycle_cache();
+
+        int clock;
+
+        for (clock = 0; clock < SCM_MAX_CLOCKS; clock++) {
+            if (descriptor_root->leases[clock].capacity != 0) {
+#ifdef SCM_MEMORY_BUDGETS
+                charge_leases(clock);
+#endif
+                end_leases(clock);
+            }
+        }
+
+        //records of rings do not outlive the thread that ticks them
+        while (descriptor_root->rings != NULL) {
+            destroy_ring(descriptor_root->rings);
+        }
+
+        //pools are adopted by later pools, not by the next thread
+        int pool;
 
-        lock_descriptor_roots();
+        for (pool = 0; pool < SCM_MAX_POOLS; pool++) {
+            if (descriptor_root->pools[pool] != NULL) {
+                orphan_pool(descriptor_root->pools[pool]);
+                descriptor_root->pools[pool] = NULL;
+            }
+        }
 
-        descriptor_root->next = terminated_descriptor_roots;
-        terminated_descriptor_roots = descriptor_root;
+        lock_descriptor_roots(heap);
 
-        descriptor_root = NULL;
+        descriptor_root->next = heap->terminated_descriptor_roots;
+        heap->terminated_descriptor_roots = descriptor_root;
 
-        unlock_descriptor_roots();
+        unlock_descriptor_roots(heap);
+
+        heap_roots[i] = NULL;
     }
+
+    descriptor_root = NULL;
+    current_heap = NULL;
 }
 
 static pthread_key_t descriptor_root_key;
@@ -410,7 +727,7 @@ static void make_key() {
 
 static pthread_once_t thread_once_control = PTHREAD_ONCE_INIT;
 
-static void create_descriptor_root() {
+void create_descriptor_root() {
     if (descriptor_root != NULL) {
         return;
     }
@@ -435,6 +752,107 @@ static void create_descriptor_root() {
     }
 }
 
+/**
+ * scm_heap_create() takes an unused entry of heaps. The limits of the heap
+ * are clamped to the compile time limits.
+ */
+scm_heap_t *scm_heap_create(unsigned int max_extension,
+        unsigned int max_clocks) {
+    if (max_extension == 0 || max_extension > SCM_MAX_EXPIRATION_EXTENSION) {
+        max_extension = SCM_MAX_EXPIRATION_EXTENSION;
+    }
+    if (max_clocks == 0 || max_clocks > SCM_MAX_CLOCKS) {
+        max_clocks = SCM_MAX_CLOCKS;
+    }
+
+    pthread_mutex_lock(&heaps_lock);
+
+    unsigned int i;
+
+    for (i = 1; i < SCM_MAX_HEAPS; i++) {
+        if (!heaps[i].used) break;
+    }
+
+    if (i >= SCM_MAX_HEAPS) {
+        pthread_mutex_unlock(&heaps_lock);
+#ifdef SCM_DEBUG
+        printf("Heap contingency exceeded.\n");
+#endif
+        return NULL;
+    }
+
+    scm_heap_t *heap = &heaps[i];
+
+    heap->global_time = 0;
+    heap->number_of_threads = 0;
+    heap->ticked_threads_countdown = 1;
+    pthread_mutex_init(&heap->global_time_lock, NULL);
+    heap->terminated_descriptor_roots = NULL;
+    pthread_mutex_init(&heap->terminated_descriptor_roots_lock, NULL);
+    heap->max_extension = max_extension;
+    heap->max_clocks = max_clocks;
+    heap->index = i;
+    heap->used = true;
+
+    pthread_mutex_unlock(&heaps_lock);
+
+    return heap;
+}
+
+scm_heap_t *scm_heap_default(void) {
+    return &heaps[0];
+}
+
+/**
+ * scm_heap_switch() parks the thread in its current heap, i.e. blocks it
+ * there unless it is blocked already, and continues with its descriptor
+ * root of the new heap, which is created on first use.
+ */
+scm_heap_t *scm_heap_switch(scm_heap_t *heap) {
+    if (heap == NULL || heap < heaps || heap >= heaps + SCM_MAX_HEAPS
+            || !heap->used) {
+#ifdef SCM_DEBUG
+        printf("Heap is invalid.\n");
+#endif
+        return NULL;
+    }
+
+    scm_heap_t *previous = this_heap();
+
+    if (heap == previous) return previous;
+
+    if (descriptor_root != NULL && !descriptor_root->blocked) {
+        scm_block_thread_internal();
+        descriptor_root->parked = true;
+    }
+
+    current_heap = heap;
+    descriptor_root = heap_roots[heap->index];
+
+    if (descriptor_root != NULL && descriptor_root->parked) {
+        descriptor_root->parked = false;
+        scm_resume_thread_internal();
+    }
+
+    return previous;
+}
+
+void scm_heap_set_max_extension(scm_heap_t *heap,
+        unsigned int max_extension) {
+    if (heap == NULL) return;
+
+    if (max_extension > SCM_MAX_EXPIRATION_EXTENSION) {
+#ifdef SCM_DEBUG
+        printf("Violation of SCM_MAX_EXPIRATION_EXTENSION.\n");
+#endif
+        max_extension = SCM_MAX_EXPIRATION_EXTENSION;
+    }
+
+    //refresh calls read the limit without synchronization, a thread may
+    //use the old limit for a moment
+    heap->max_extension = max_extension;
+}
+
 /**
  * scm_register_clock() returns a const integer representing
  * a new clock in the short-term memory model.
@@ -453,12 +871,22 @@ const int scm_register_clock() {
         return(-1);
     }
 
-    int start_index = descriptor_root->next_clock_index;
-    int i = start_index;
+    unsigned int max_clocks = descriptor_root->heap->max_clocks;
+
+    if (max_clocks <= 1) {
+#ifdef SCM_DEBUG
+        printf("The heap has no clocks besides the base clock.\n");
+#endif
+        return(-1);
+    }
+
+    int start_index = descriptor_root->next_clock_index % max_clocks;
+    int i = start_index != 0 ? start_index : 1;
+    start_index = i;
     
     while (descriptor_root->locally_clocked_obj_buffer[i].age ==
             descriptor_root->current_time) {
-        i = (i+1) % SCM_MAX_CLOCKS;
+        i = (i+1) % max_clocks;
         i = i != 0 ? i : 1;
         if (i == start_index) {
 #ifdef SCM_DEBUG
@@ -467,7 +895,7 @@ const int scm_register_clock() {
             return(-1);
         }
     }
-    start_index = (i+1) % SCM_MAX_CLOCKS;
+    start_index = (i+1) % max_clocks;
     start_index = start_index != 0 ? start_index : 1;
     descriptor_root->next_clock_index = start_index;
 
@@ -481,6 +909,8 @@ const int scm_register_clock() {
     descriptor_root->locally_clocked_reg_buffer[i].age =
         descriptor_root->current_time;
 
+    invalidate_lifetime_classes();
+
     return (const int) i;
 }
 
@@ -495,17 +925,32 @@ void scm_unregister_clock(const int clock) {
         return;
     }
 
-    if (clock <= 1 || clock >= SCM_MAX_CLOCKS) {
+    if (clock < 1 || !valid_clock(clock)) {
 #ifdef SCM_DEBUG
         printf("Clock index is invalid.\n");
 #endif
         return;
     }
 
+    //leases expire through the zombie buffer like refreshed objects
+    if (descriptor_root->leases[clock].count != 0) {
+#ifdef SCM_MEMORY_BUDGETS
+        charge_leases(clock);
+#endif
+        end_leases(clock);
+    }
+
     descriptor_root->locally_clocked_obj_buffer[clock].age =
         (descriptor_root->current_time - 1);
     descriptor_root->locally_clocked_reg_buffer[clock].age =
         (descriptor_root->current_time - 1);
+
+    invalidate_lifetime_classes();
+
+#ifdef SCM_MEMORY_BUDGETS
+    //the bytes of the zombie buffer are released as its slots expire
+    descriptor_root->clock_budgets[clock].limit = 0;
+#endif
 }
 
 /**
@@ -667,36 +1112,191 @@ void scm_unregister_region(const int region) {
         (descriptor_root->current_time - 1);
 }
 
-inline void *scm_malloc(size_t size) {
-    return __wrap_malloc_internal(size);
-}
-
 /**
- * scm_malloc_in_region() allocates memory in a region.
- * It adds space for an object header to
- * the requested memory and initializes the
- * memory header.
- *
- * Every memory allocation request is aligned to
- * a word to effectively use cache lines.
- *
- * If the requested amount of memory is bigger than the
- * max region_page payload size, scm_malloc_in_region() returns NULL.
- * If the region does not contain at least one
- * region_page it was not correctly initialized and
- * scm_malloc_in_region() returns a NULL pointer.
+ * scm_pool_create() returns a new pool of the calling thread for objects
+ * of object_size bytes whose payload is aligned to alignment, or -1 if no
+ * pool is available or the parameters are invalid.
  */
-void* scm_malloc_in_region(size_t size, const int region_index) {
-    size_t requested_size = size + sizeof(object_header_t);
-    unsigned int needed_space = CACHEALIGN(requested_size);
+const int scm_pool_create(size_t object_size, size_t alignment) {
+    create_descriptor_root();
 
-    if (needed_space > SCM_REGION_PAGE_PAYLOAD_SIZE) {
+    int i;
+
+    for (i = 0; i < SCM_MAX_POOLS; i++) {
+        if (descriptor_root->pools[i] != NULL) continue;
+
+        descriptor_root->pools[i] = new_pool(object_size, alignment);
+
+        if (descriptor_root->pools[i] == NULL) {
 #ifdef SCM_DEBUG
-        printf("The region allocator does not support memory of this size.\n");
+            printf("Pool of objects of size %zu and alignment %zu "
+                    "is not supported.\n", object_size, alignment);
 #endif
-        return NULL;
-    }
-
+            return -1;
+        }
+
+        return (const int) i;
+    }
+
+#ifdef SCM_DEBUG
+    printf("Pool contingency exceeded.\n");
+#endif
+    return -1;
+}
+
+/**
+ * scm_pool_destroy() orphans a pool of the calling thread. Its objects
+ * still expire and return to the pool, whose pages are reused by the next
+ * pool for objects of the same size and alignment.
+ */
+void scm_pool_destroy(const int pool_index) {
+    if (descriptor_root == NULL || pool_index < 0
+            || pool_index >= SCM_MAX_POOLS
+            || descriptor_root->pools[pool_index] == NULL) {
+#ifdef SCM_DEBUG
+        printf("Pool index is invalid.\n");
+#endif
+        return;
+    }
+
+    orphan_pool(descriptor_root->pools[pool_index]);
+
+    descriptor_root->pools[pool_index] = NULL;
+}
+
+/**
+ * scm_malloc_in_pool() allocates an object of the pool. The object header
+ * is initialized like the header of an object allocated by scm_malloc.
+ */
+void *scm_malloc_in_pool(const int pool_index) {
+    if (pool_index < 0 || pool_index >= SCM_MAX_POOLS) {
+#ifdef SCM_DEBUG
+        printf("Pool index is invalid.\n");
+#endif
+        return NULL;
+    }
+
+    create_descriptor_root();
+
+    pool_t *pool = descriptor_root->pools[pool_index];
+
+    if (pool == NULL) {
+#ifdef SCM_DEBUG
+        printf("Cannot allocate from an unused pool.\n");
+#endif
+        return NULL;
+    }
+
+    object_header_t *object = new_pool_object(pool);
+
+    if (object == NULL) return NULL;
+
+    object->dc_or_region_id = 0;
+    object->finalizer_index = -1;
+    if (SET_OBJECT_OWNER(object, 0) != 0) {
+        release_pool_object(object);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return PAYLOAD_OFFSET(object);
+}
+
+/**
+ * new_ring() creates a ring buffer of the calling thread for the clock.
+ */
+static int new_ring(size_t bytes, const unsigned int clock, bool spsc) {
+    if (!valid_clock(clock)) {
+#ifdef SCM_DEBUG
+        printf("Clock is invalid.\n");
+#endif
+        return -1;
+    }
+
+    create_descriptor_root();
+
+    return create_ring(bytes, clock, spsc);
+}
+
+const int scm_ring_create(size_t bytes, const unsigned int clock) {
+    return new_ring(bytes, clock, false);
+}
+
+const int scm_ring_create_spsc(size_t bytes, const unsigned int clock) {
+    return new_ring(bytes, clock, true);
+}
+
+/**
+ * scm_ring_malloc() appends a record to the ring. The record has an object
+ * header, so that free and refresh calls on it are ignored.
+ */
+void *scm_ring_malloc(const int ring_index, size_t size) {
+    if (ring_index < 0 || ring_index >= SCM_MAX_RINGS
+            || rings[ring_index].buffer == NULL) {
+#ifdef SCM_DEBUG
+        printf("Ring index is invalid.\n");
+#endif
+        return NULL;
+    }
+
+    object_header_t *object = new_ring_object(&rings[ring_index], size);
+
+    if (object == NULL) return NULL;
+
+    //the record is released with the ring
+    if (SET_OBJECT_OWNER(object, 0) != 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return PAYLOAD_OFFSET(object);
+}
+
+void scm_ring_destroy(const int ring_index) {
+    if (descriptor_root == NULL || ring_index < 0
+            || ring_index >= SCM_MAX_RINGS
+            || rings[ring_index].buffer == NULL
+            || rings[ring_index].owner != descriptor_root) {
+#ifdef SCM_DEBUG
+        printf("Ring index is invalid or the ring belongs to another "
+                "thread.\n");
+#endif
+        return;
+    }
+
+    destroy_ring(&rings[ring_index]);
+}
+
+inline void *scm_malloc(size_t size) {
+    return __wrap_malloc_internal(size);
+}
+
+/**
+ * scm_malloc_in_region() allocates memory in a region.
+ * It adds space for an object header to
+ * the requested memory and initializes the
+ * memory header.
+ *
+ * Every memory allocation request is aligned to
+ * a word to effectively use cache lines.
+ *
+ * If the requested amount of memory is bigger than the
+ * max region_page payload size, scm_malloc_in_region() returns NULL.
+ * If the region does not contain at least one
+ * region_page it was not correctly initialized and
+ * scm_malloc_in_region() returns a NULL pointer.
+ */
+void* scm_malloc_in_region(size_t size, const int region_index) {
+    size_t requested_size = size + sizeof(object_header_t);
+    unsigned int needed_space = CACHEALIGN(requested_size);
+
+    if (needed_space > SCM_REGION_PAGE_PAYLOAD_SIZE) {
+#ifdef SCM_DEBUG
+        printf("The region allocator does not support memory of this size.\n");
+#endif
+        return NULL;
+    }
+
     if (region_index < 0 || region_index >= SCM_MAX_REGIONS) {
 #ifdef SCM_DEBUG
         printf("Region index is invalid.\n");
@@ -746,6 +1346,11 @@ void* scm_malloc_in_region(size_t size, const int region_index) {
 
     new_obj->dc_or_region_id = region_index | HB_MASK;
     new_obj->finalizer_index = -1;
+    //the space is released with the region
+    if (SET_OBJECT_OWNER(new_obj, 0) != 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
 
 // check post-conditions
 #ifdef SCM_CHECK_CONDITIONS
@@ -771,6 +1376,99 @@ inline void scm_free(void *ptr) {
     __wrap_free_internal(ptr);
 }
 
+/**
+ * release_payload_pages() returns the pages that lie completely within the
+ * payload of an object to the operating system. The pages read as zero
+ * afterwards, the chunk itself remains allocated.
+ */
+static void release_payload_pages(object_header_t *object) {
+    const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+    uintptr_t payload = (uintptr_t) PAYLOAD_OFFSET(object);
+    uintptr_t start = ROUND_UP(payload, page_size);
+    uintptr_t end = ROUND_DOWN(payload + OBJECT_USABLE_SIZE(object),
+            page_size);
+
+    if (start < end) {
+        madvise((void*) start, end - start, MADV_DONTNEED);
+    }
+}
+
+/**
+ * scm_free_now() frees an object that is dead although it may still have
+ * descriptors. The finalizer of the object runs immediately. If the object
+ * has no other descriptors it is freed, otherwise the whole pages of its
+ * payload are released and the remaining chunk is freed when the last
+ * descriptor expires, without running the finalizer again. Objects smaller
+ * than a page keep their chunk until then.
+ */
+void scm_free_now(void *ptr) {
+    if (ptr == NULL) return;
+
+    if (!is_scm_object(ptr)) {
+        __real_free(ptr);
+        return;
+    }
+
+    object_header_t* object = OBJECT_HEADER(ptr);
+
+    if (object->dc_or_region_id < 0) {
+#ifdef SCM_DEBUG
+        printf("Cannot free single objects from a region.\n");
+#endif
+        return;
+    }
+
+    if (object->dc_or_region_id == TICK_ARENA_OBJECT) {
+#ifdef SCM_DEBUG
+        printf("Cannot free single objects from a tick arena.\n");
+#endif
+        return;
+    }
+
+    //hold the object, otherwise expiring descriptors of other threads
+    //may run its finalizer and free it while it is finalized here
+    int dc = atomic_int_exchange_and_add_relaxed(
+            &object->dc_or_region_id, 1);
+
+    //descriptors expiring from now on only decrement the counter, the
+    //exchange keeps two threads from running the finalizer
+    int finalizer_index = atomic_int_exchange(&object->finalizer_index, -1);
+
+    if (run_finalizer_index(object, finalizer_index) != 0) {
+#ifdef SCM_DEBUG
+        printf("Finalizer keeps object %lx alive.\n", (unsigned long) ptr);
+#endif
+        object->finalizer_index = finalizer_index;
+
+        if (dc == 0) {
+            //without descriptors nothing else may free the object
+            atomic_int_add(&object->dc_or_region_id, -1);
+            return;
+        }
+
+        //the last descriptor expired while the object was held, which
+        //leaves finalizing and freeing to this thread
+        if (atomic_int_dec_and_test(&object->dc_or_region_id)
+                && run_finalizer(object) == 0) {
+            free_object(object);
+        }
+        return;
+    }
+
+    if (dc >= PINNED_BIAS) {
+        atomic_int_add(&object->dc_or_region_id, -PINNED_BIAS);
+        dc -= PINNED_BIAS;
+    }
+
+    if (dc > 0 && !is_pool_object(object)) {
+        release_payload_pages(object);
+    }
+
+    if (atomic_int_dec_and_test(&object->dc_or_region_id)) {
+        free_object(object);
+    }
+}
+
 /**
  * Collects descriptors incrementally
  */
@@ -801,267 +1499,1390 @@ inline void scm_collect(void) {
  * extension time.
  */
 static inline unsigned int check_extension(unsigned int given_extension) {
-    if (given_extension > SCM_MAX_EXPIRATION_EXTENSION) {
+    unsigned int max_extension = this_heap()->max_extension;
+
+    if (given_extension > max_extension) {
 #ifdef SCM_DEBUG
-        printf("Violation of SCM_MAX_EXPIRATION_EXTENSION.\n");
+        printf("Violation of the maximal expiration extension of the heap.\n");
 #endif
-        return SCM_MAX_EXPIRATION_EXTENSION;
+        return max_extension;
     } else {
         return given_extension;
     }
 }
 
+#ifdef SCM_MEMORY_BUDGETS
+static inline void tick_clock(const unsigned int clock);
+static void eager_collect(void);
+
+/**
+ * Returns the bytes an object keeps alive, see __wrap_malloc_usable_size.
+ */
+static inline size_t object_bytes(object_header_t *object) {
+    if (is_pool_object(object)) return pool_object_size(object);
+
+    return OBJECT_USABLE_SIZE(object);
+}
+
+static inline size_t region_bytes(region_t *region) {
+    return (size_t) region->number_of_region_pages * SCM_REGION_PAGE_SIZE;
+}
+
 /**
- * scm_refresh_with_clock() refreshes a given object with a given clock,
- * which can be different to the thread-local base clock.
- * If an object is refreshed with multiple clocks it lives
- * until all clocks ticked n times, where n is the respective extension.
- * If the object is part of a region, the region is refreshed instead.
+ * Returns the budget of the clock or of the thread that bytes more would
+ * exceed, the clock budget first, or NULL.
  */
-void scm_refresh_with_clock(void *ptr, unsigned int extension, const unsigned int clock) {
-    MICROBENCHMARK_START
+static inline memory_budget_t *exceeded_budget(const unsigned int clock,
+        size_t bytes) {
+    memory_budget_t *budget = &descriptor_root->clock_budgets[clock];
 
-    if (ptr == NULL) {
-#ifdef SCM_DEBUG
-        printf("Cannot refresh NULL pointer.\n");
-#endif
-        return;
+    if (budget->limit != 0 && budget->used + bytes > budget->limit) {
+        return budget;
     }
 
-    object_header_t* object = OBJECT_HEADER(ptr);
+    budget = &descriptor_root->thread_budget;
 
-    // is the object allocated into a region?
-    if (object->dc_or_region_id < 0) {
-        int region_id = object->dc_or_region_id & ~HB_MASK;
+    if (budget->limit != 0 && budget->used + bytes > budget->limit) {
+        return budget;
+    }
 
-        scm_refresh_region_with_clock(region_id, extension, clock);
-    } else {
-        if (object->dc_or_region_id == INT_MAX) {
-#ifdef SCM_DEBUG
-            printf("Descriptor counter reached max value.\n");
-#endif
-            return;
-        }
+    return NULL;
+}
 
-        extension = check_extension(extension);
+/**
+ * Charges bytes to the slot of the clock in which a descriptor with the
+ * extension expires.
+ */
+static inline void charge_budget_slot(const unsigned int clock,
+        unsigned int extension, size_t bytes) {
+    descriptor_buffer_t *buffer =
+        &descriptor_root->locally_clocked_obj_buffer[clock];
+
+    descriptor_root->budget_slot_bytes[clock][
+        (buffer->current_index + extension) % buffer->not_expired_length]
+        += bytes;
+    descriptor_root->clock_budgets[clock].used += bytes;
+    descriptor_root->thread_budget.used += bytes;
+}
 
-        if (clock < 0 || clock >= SCM_MAX_CLOCKS) {
-#ifdef SCM_DEBUG
-            printf("Clock is invalid.\n");
-#endif
-            return;
+/**
+ * Applies the policy of an exceeded budget to a descriptor of bytes bytes
+ * and charges the bytes to the slot of the clock in which the descriptor
+ * expires. Returns the extension of the descriptor. SCM_BUDGET_TICK ticks
+ * the clock until the budget holds or all slots of the clock expired and
+ * frees the expired objects, so the caller must have incremented the
+ * descriptor counter of its target before. A refresh never fails, with
+ * SCM_BUDGET_FAIL only allocations fail, see allocation_fits_budget.
+ */
+static unsigned int charge_budgets(const unsigned int clock,
+        unsigned int extension, size_t bytes) {
+    memory_budget_t *budget = exceeded_budget(clock, bytes);
+
+    if (budget != NULL) {
+        if (budget->policy == SCM_BUDGET_TICK) {
+            unsigned int ticks = 0;
+
+            do {
+                tick_clock(clock);
+                ticks++;
+            } while (exceeded_budget(clock, bytes) != NULL && ticks <
+                    descriptor_root->locally_clocked_obj_buffer[clock]
+                    .not_expired_length);
+
+            eager_collect();
+        } else if (budget->policy == SCM_BUDGET_SHORTEN) {
+            extension = 0;
         }
+    }
 
-        create_descriptor_root();
+    charge_budget_slot(clock, extension, bytes);
 
-// check pre-conditions
-#ifdef SCM_CHECK_CONDITIONS
-        if (descriptor_root->current_time !=
-                descriptor_root->locally_clocked_obj_buffer[clock].age ||
-                descriptor_root->locally_clocked_obj_buffer[clock]
-                .not_expired_length == 0) {
-            printf("Cannot refresh zombie clock.\n");
-            return;
-        }
-#endif
+    return extension;
+}
 
-        atomic_int_inc((int*) & object->dc_or_region_id);
-        insert_descriptor(object,
-                          &descriptor_root->locally_clocked_obj_buffer[clock], extension);
+/**
+ * Charges the descriptors that the leases of the clock become when the
+ * clock or the thread is unregistered. No policy applies: the clock
+ * cannot be ticked any longer and the lease periods are kept.
+ */
+static void charge_leases(const unsigned int clock) {
+    lease_table_t *table = &descriptor_root->leases[clock];
+    unsigned int i;
 
-#ifndef SCM_EAGER_COLLECTION
-        lazy_collect();
-#else
-        //do nothing. expired descriptors are collected at tick
-#endif
+    for (i = 0; i < table->capacity; i++) {
+        lease_t *lease = &table->entries[i];
+
+        if (lease->target == NULL) continue;
+
+        charge_budget_slot(clock, lease->period, lease->region ?
+            region_bytes(lease->target) : object_bytes(lease->target));
     }
-    
-#ifdef SCM_RECORD_MEMORY_USAGE
-    print_memory_consumption();
+}
+
+/**
+ * Returns false if an allocation of bytes bytes for the clock exceeds a
+ * budget with the SCM_BUDGET_FAIL policy. bytes must be the count that is
+ * charged for the allocation, not the requested size.
+ */
+static inline bool allocation_fits_budget(const unsigned int clock,
+        size_t bytes) {
+    memory_budget_t *budget = exceeded_budget(clock, bytes);
+
+    if (budget != NULL && budget->policy == SCM_BUDGET_FAIL) {
+#ifdef SCM_DEBUG
+        printf("Allocation exceeds the memory budget.\n");
 #endif
+        errno = ENOMEM;
+        return false;
+    }
 
-    MICROBENCHMARK_STOP
-    MICROBENCHMARK_DURATION("scm_refresh_with_clock")
+    return true;
 }
 
 /**
- * scm_refresh() is the same as scm_global_refresh without the
- * additional extension to accommodate other threads.
- * In a multi-clock environment, scm_refresh refreshes
- * the object with the thread-local base clock.
- * If the object is part of a region, the region is refreshed instead.
+ * Releases the bytes charged to the slot of the clock that just expired.
  */
-void scm_refresh(void *ptr, unsigned int extension) {
-    scm_refresh_with_clock(ptr, extension, 0);
+static inline void release_budget_slot(const unsigned int clock,
+        unsigned int expired_index) {
+    size_t bytes = descriptor_root->budget_slot_bytes[clock][expired_index];
+
+    descriptor_root->budget_slot_bytes[clock][expired_index] = 0;
+    descriptor_root->clock_budgets[clock].used -= bytes;
+    descriptor_root->thread_budget.used -= bytes;
 }
+#endif
 
 /**
- * scm_global_refresh adds extension time units + 2 to the expiration time of
- * ptr making sure that all other threads have enough time to also call
- * global_refresh(ptr, extension). If the object is part of a region, the
- * region is refreshed instead.
+ * refresh_object() is the unchecked part of scm_refresh_with_clock.
+ * The object must not be part of a region.
+ */
+static inline void refresh_object(object_header_t *object,
+        unsigned int extension, const unsigned int clock) {
+    atomic_int_inc((int*) & object->dc_or_region_id);
+#ifdef SCM_MEMORY_BUDGETS
+    extension = charge_budgets(clock, extension, object_bytes(object));
+#endif
+    insert_descriptor(object,
+                      &descriptor_root->locally_clocked_obj_buffer[clock], extension);
+
+#ifndef SCM_EAGER_COLLECTION
+    lazy_collect();
+#else
+    //do nothing. expired descriptors are collected at tick
+#endif
+}
+
+/**
+ * refresh_region() is the unchecked part of scm_refresh_region_with_clock.
+ */
+static inline void refresh_region(region_t *region,
+        unsigned int extension, const unsigned int clock) {
+    atomic_int_inc((int*) &region->dc);
+#ifdef SCM_MEMORY_BUDGETS
+    extension = charge_budgets(clock, extension, region_bytes(region));
+#endif
+    insert_descriptor(region,
+                      &descriptor_root->locally_clocked_reg_buffer[clock], extension);
+
+#ifndef SCM_EAGER_COLLECTION
+    lazy_collect();
+#else
+    //do nothing. expired descriptors are collected at tick
+#endif
+}
+
+extern __typeof__(scm_refresh_region_with_clock)
+    scm_refresh_region_with_clock_internal
+    __attribute__((visibility("hidden")));
+
+/**
+ * refresh_multi() adds the descriptors of a target, i.e. an object header or
+ * a region, to the buffers of all clocks in clock_mask with a single update
+ * of its descriptor counter and a single collection step. clock_mask only
+ * contains valid clocks.
+ */
+static inline void refresh_multi(void *target, int *dc,
+        descriptor_buffer_t *buffers, unsigned long clock_mask,
+        const unsigned int *extensions) {
+    atomic_int_add_relaxed(dc, __builtin_popcountl(clock_mask));
+
+#ifdef SCM_MEMORY_BUDGETS
+    size_t bytes = buffers == descriptor_root->locally_clocked_obj_buffer ?
+        object_bytes(target) : region_bytes(target);
+#endif
+
+    while (clock_mask != 0) {
+        unsigned int clock = __builtin_ctzl(clock_mask);
+        unsigned int extension = check_extension(extensions[clock]);
+
+#ifdef SCM_MEMORY_BUDGETS
+        extension = charge_budgets(clock, extension, bytes);
+#endif
+        insert_descriptor(target, &buffers[clock], extension);
+
+        clock_mask &= clock_mask - 1;
+    }
+
+#ifndef SCM_EAGER_COLLECTION
+    lazy_collect();
+#else
+    //do nothing. expired descriptors are collected at tick
+#endif
+}
+
+/**
+ * Returns the clocks of clock_mask that exist in the current heap of the
+ * thread and are registered by it, the others have no descriptor buffers.
+ * The thread has a descriptor root.
+ */
+static inline unsigned long valid_clocks(unsigned long clock_mask) {
+    unsigned int max_clocks = descriptor_root->heap->max_clocks;
+    unsigned long valid_mask = clock_mask;
+
+    if (max_clocks < __SIZEOF_LONG__ * 8) {
+        valid_mask &= (1UL << max_clocks) - 1;
+    }
+
+    unsigned long clocks = valid_mask;
+
+    while (clocks != 0) {
+        int clock = __builtin_ctzl(clocks);
+
+        clocks &= clocks - 1;
+
+        if (descriptor_root->locally_clocked_obj_buffer[clock].age !=
+                descriptor_root->current_time) {
+            valid_mask &= ~(1UL << clock);
+        }
+    }
+
+#ifdef SCM_DEBUG
+    if (valid_mask != clock_mask) {
+        printf("Clock is invalid.\n");
+    }
+#endif
+
+    return valid_mask;
+}
+
+/**
+ * scm_refresh_with_clock() refreshes a given object with a given clock,
+ * which can be different to the thread-local base clock.
+ * If an object is refreshed with multiple clocks it lives
+ * until all clocks ticked n times, where n is the respective extension.
+ * If the object is part of a region, the region is refreshed instead.
+ */
+void scm_refresh_with_clock(void *ptr, unsigned int extension, const unsigned int clock) {
+    MICROBENCHMARK_START
+
+    if (ptr == NULL) {
+#ifdef SCM_DEBUG
+        printf("Cannot refresh NULL pointer.\n");
+#endif
+        return;
+    }
+
+    object_header_t* object = OBJECT_HEADER(ptr);
+
+    // is the object allocated into a region?
+    if (object->dc_or_region_id < 0) {
+        int region_id = object->dc_or_region_id & ~HB_MASK;
+
+        scm_refresh_region_with_clock_internal(region_id, extension, clock);
+    } else {
+        if (object->dc_or_region_id >= PINNED_BIAS) {
+#ifdef SCM_DEBUG
+            printf("Object is pinned or its descriptor counter reached "
+                    "max value.\n");
+#endif
+            return;
+        }
+
+        extension = check_extension(extension);
+
+        if (!valid_clock(clock)) {
+#ifdef SCM_DEBUG
+            printf("Clock is invalid.\n");
+#endif
+            return;
+        }
+
+        create_descriptor_root();
+
+// check pre-conditions
+#ifdef SCM_CHECK_CONDITIONS
+        if (descriptor_root->current_time !=
+                descriptor_root->locally_clocked_obj_buffer[clock].age ||
+                descriptor_root->locally_clocked_obj_buffer[clock]
+                .not_expired_length == 0) {
+            printf("Cannot refresh zombie clock.\n");
+            return;
+        }
+#endif
+
+        refresh_object(object, extension, clock);
+    }
+    
+#ifdef SCM_RECORD_MEMORY_USAGE
+    print_memory_consumption();
+#endif
+
+    MICROBENCHMARK_STOP
+    MICROBENCHMARK_DURATION("scm_refresh_with_clock")
+}
+
+extern __typeof__(scm_refresh_with_clock) scm_refresh_with_clock_internal
+    __attribute__((weak, alias("scm_refresh_with_clock"),
+                visibility("hidden")));
+
+/**
+ * scm_refresh() is the same as scm_global_refresh without the
+ * additional extension to accommodate other threads.
+ * In a multi-clock environment, scm_refresh refreshes
+ * the object with the thread-local base clock.
+ * If the object is part of a region, the region is refreshed instead.
+ */
+void scm_refresh(void *ptr, unsigned int extension) {
+    scm_refresh_with_clock_internal(ptr, extension, 0);
+}
+
+/**
+ * scm_refresh_multi() validates the clock mask once and refreshes the
+ * object (or its region) on all clocks of the mask at once.
+ */
+void scm_refresh_multi(void *ptr, unsigned long clock_mask,
+        const unsigned int *extensions) {
+    MICROBENCHMARK_START
+
+    if (ptr == NULL) {
+#ifdef SCM_DEBUG
+        printf("Cannot refresh NULL pointer.\n");
+#endif
+        return;
+    }
+
+    create_descriptor_root();
+
+    clock_mask = valid_clocks(clock_mask);
+
+    if (clock_mask == 0) return;
+
+    object_header_t* object = OBJECT_HEADER(ptr);
+
+    if (object->dc_or_region_id < 0) {
+        region_t *region = &descriptor_root->regions[
+            object->dc_or_region_id & ~HB_MASK];
+
+        if (region->dc < PINNED_BIAS) {
+            refresh_multi(region, (int*) &region->dc,
+                    descriptor_root->locally_clocked_reg_buffer, clock_mask,
+                    extensions);
+        }
+    } else if (object->dc_or_region_id < PINNED_BIAS) {
+        refresh_multi(object, (int*) &object->dc_or_region_id,
+                descriptor_root->locally_clocked_obj_buffer, clock_mask,
+                extensions);
+    } else {
+#ifdef SCM_DEBUG
+        printf("Object is pinned or its descriptor counter reached "
+                "max value.\n");
+#endif
+    }
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    print_memory_consumption();
+#endif
+
+    MICROBENCHMARK_STOP
+    MICROBENCHMARK_DURATION("scm_refresh_multi")
+}
+
+void scm_refresh_region_multi(const int region_index,
+        unsigned long clock_mask, const unsigned int *extensions) {
+
+    if (region_index < 0 || region_index >= SCM_MAX_REGIONS) {
+#ifdef SCM_DEBUG
+        printf("Region index is invalid.\n");
+#endif
+        return;
+    }
+
+    create_descriptor_root();
+
+    clock_mask = valid_clocks(clock_mask);
+
+    if (clock_mask == 0) return;
+
+    region_t* region = &descriptor_root->regions[region_index];
+
+    if (region->dc >= PINNED_BIAS) {
+#ifdef SCM_DEBUG
+        printf("Region is pinned or its descriptor counter reached "
+                "max value.\n");
+#endif
+        return;
+    }
+
+    refresh_multi(region, (int*) &region->dc,
+            descriptor_root->locally_clocked_reg_buffer, clock_mask,
+            extensions);
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    print_memory_consumption();
+#endif
+}
+
+/**
+ * Appends item to the vector, returns false if out of memory.
+ */
+static inline bool push_pointer(pointer_vector_t *vector, void *item) {
+    if (__builtin_expect(vector->length == vector->capacity, 0)) {
+        size_t capacity = vector->capacity == 0 ? 64 : 2 * vector->capacity;
+        void **items = __real_realloc(vector->items, capacity * sizeof(void*));
+
+        if (items == NULL) {
+#ifdef SCM_DEBUG
+            printf("Memory for graph walk could not be allocated.\n");
+#endif
+            return false;
+        }
+
+        vector->items = items;
+        vector->capacity = capacity;
+    }
+
+    vector->items[vector->length++] = item;
+
+    return true;
+}
+
+static inline size_t visited_slot(void *ptr, size_t capacity) {
+    // Fibonacci hashing of the address without its alignment bits
+    unsigned long long hash =
+        ((uintptr_t) ptr >> 3) * 11400714819323198485ULL;
+
+    return (size_t) (hash >> 32) & (capacity - 1);
+}
+
+/**
+ * Doubles the visited set of the walk and rehashes its entries.
+ */
+static bool grow_visited_set(graph_walk_t *walk) {
+    size_t capacity =
+        walk->visited_capacity == 0 ? 256 : 2 * walk->visited_capacity;
+    void **visited = __real_calloc(capacity, sizeof(void*));
+    size_t i;
+
+    if (visited == NULL) {
+#ifdef SCM_DEBUG
+        printf("Memory for graph walk could not be allocated.\n");
+#endif
+        return false;
+    }
+
+    for (i = 0; i < walk->visited_capacity; i++) {
+        void *ptr = walk->visited[i];
+
+        if (ptr != NULL) {
+            size_t slot = visited_slot(ptr, capacity);
+
+            while (visited[slot] != NULL) slot = (slot + 1) & (capacity - 1);
+
+            visited[slot] = ptr;
+        }
+    }
+
+    __real_free(walk->visited);
+    walk->visited = visited;
+    walk->visited_capacity = capacity;
+
+    return true;
+}
+
+/**
+ * Adds ptr to the visited set of the walk. Returns 1 if ptr was not visited
+ * before, 0 if it was and -1 if the set is out of memory.
+ */
+static inline int visit(graph_walk_t *walk, void *ptr) {
+    if (2 * (walk->number_visited + 1) > walk->visited_capacity &&
+            !grow_visited_set(walk)) {
+        return -1;
+    }
+
+    size_t mask = walk->visited_capacity - 1;
+    size_t slot = visited_slot(ptr, walk->visited_capacity);
+
+    while (walk->visited[slot] != NULL) {
+        if (walk->visited[slot] == ptr) return 0;
+
+        slot = (slot + 1) & mask;
+    }
+
+    walk->visited[slot] = ptr;
+    walk->number_visited++;
+
+    return 1;
+}
+
+/**
+ * scm_refresh_graph() increments the descriptor counters during the walk
+ * and inserts the descriptors of all objects and regions at once when the
+ * walk is done, followed by a single collection step. If the walk runs out
+ * of memory it stops, the objects reached so far are refreshed all the
+ * same.
+ */
+int scm_refresh_graph(void *root, unsigned int extension,
+        const unsigned int clock) {
+    MICROBENCHMARK_START
+
+    if (root == NULL) {
+#ifdef SCM_DEBUG
+        printf("Cannot refresh NULL pointer.\n");
+#endif
+        errno = EINVAL;
+        return -1;
+    }
+
+    extension = check_extension(extension);
+
+    if (!valid_clock(clock)) {
+#ifdef SCM_DEBUG
+        printf("Clock is invalid.\n");
+#endif
+        errno = EINVAL;
+        return -1;
+    }
+
+    create_descriptor_root();
+
+#ifdef SCM_CHECK_CONDITIONS
+    if (descriptor_root->current_time !=
+            descriptor_root->locally_clocked_obj_buffer[clock].age ||
+            descriptor_root->locally_clocked_obj_buffer[clock]
+            .not_expired_length == 0) {
+        printf("Cannot refresh zombie clock.\n");
+        return -1;
+    }
+#endif
+
+    graph_walk_t *walk = &descriptor_root->graph_walk;
+
+    if (walk->number_visited > 0) {
+        memset(walk->visited, 0, walk->visited_capacity * sizeof(void*));
+        walk->number_visited = 0;
+    }
+    walk->stack.length = 0;
+    walk->objects.length = 0;
+    walk->regions.length = 0;
+
+#ifdef SCM_MEMORY_BUDGETS
+    size_t bytes = 0;
+#endif
+
+    bool out_of_memory = !push_pointer(&walk->stack, root);
+
+    while (walk->stack.length > 0 && !out_of_memory) {
+        void *ptr = walk->stack.items[--walk->stack.length];
+
+        if (!is_scm_object(ptr)) continue;
+
+        int visited = visit(walk, ptr);
+
+        if (visited != 1) {
+            out_of_memory = visited == -1;
+            continue;
+        }
+
+        object_header_t *object = OBJECT_HEADER(ptr);
+        int dc = object->dc_or_region_id;
+
+        //objects of tick arenas have no type and are never refreshed
+        if (dc == TICK_ARENA_OBJECT) continue;
+
+        if (dc < 0) {
+            region_t *region = &descriptor_root->regions[dc & ~HB_MASK];
+
+            //the region is refreshed once, pinned regions are not
+            if (region->dc < PINNED_BIAS) {
+                visited = visit(walk, region);
+
+                if (visited == 1 && push_pointer(&walk->regions, region)) {
+                    atomic_int_inc((int*) &region->dc);
+#ifdef SCM_MEMORY_BUDGETS
+                    bytes += region_bytes(region);
+#endif
+                } else if (visited != 0) {
+                    out_of_memory = true;
+                    continue;
+                }
+            }
+        } else if (dc < PINNED_BIAS) {
+            if (!push_pointer(&walk->objects, object)) {
+                out_of_memory = true;
+                continue;
+            }
+
+            atomic_int_inc((int*) &object->dc_or_region_id);
+#ifdef SCM_MEMORY_BUDGETS
+            bytes += object_bytes(object);
+#endif
+        }
+
+        type_descriptor_t *type = get_type_descriptor(object->finalizer_index);
+
+        if (type == NULL) continue;
+
+        unsigned int i;
+
+        for (i = 0; i < type->number_of_offsets; i++) {
+            void *child = *(void**) (ptr + type->pointer_offsets[i]);
+
+            if (child != NULL && !push_pointer(&walk->stack, child)) {
+                out_of_memory = true;
+                break;
+            }
+        }
+    }
+
+#ifdef SCM_MEMORY_BUDGETS
+    //the whole graph is charged at once
+    extension = charge_budgets(clock, extension, bytes);
+#endif
+
+    insert_descriptors(walk->objects.items, walk->objects.length,
+            &descriptor_root->locally_clocked_obj_buffer[clock], extension);
+    insert_descriptors(walk->regions.items, walk->regions.length,
+            &descriptor_root->locally_clocked_reg_buffer[clock], extension);
+
+#ifndef SCM_EAGER_COLLECTION
+    lazy_collect();
+#else
+    //do nothing. expired descriptors are collected at tick
+#endif
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    print_memory_consumption();
+#endif
+
+    MICROBENCHMARK_STOP
+    MICROBENCHMARK_DURATION("scm_refresh_graph")
+
+    if (out_of_memory) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * scm_global_refresh adds extension time units + 2 to the expiration time of
+ * ptr making sure that all other threads have enough time to also call
+ * global_refresh(ptr, extension). If the object is part of a region, the
+ * region is refreshed instead.
+ */
+void scm_global_refresh(void *ptr, unsigned int extension) {
+    MICROBENCHMARK_START
+    
+    if (ptr == NULL) {
+#ifdef SCM_DEBUG
+        printf("Cannot refresh NULL pointer.\n");
+#endif
+        return;
+    }
+
+    object_header_t* object = OBJECT_HEADER(ptr);
+
+    if (object->dc_or_region_id < 0) {
+        int region_id = object->dc_or_region_id & ~HB_MASK;
+
+        scm_global_refresh_region(region_id, extension);
+    } else {
+        if (object->dc_or_region_id >= PINNED_BIAS) {
+#ifdef SCM_DEBUG
+            printf("Object is pinned or its descriptor counter reached "
+                    "max value.\n");
+#endif
+            return;
+        }
+
+        extension = check_extension(extension);
+
+        create_descriptor_root();
+
+        atomic_int_inc((int*) &object->dc_or_region_id);
+        insert_descriptor(object,
+                          &descriptor_root->globally_clocked_obj_buffer, extension + 2);
+
+#ifndef SCM_EAGER_COLLECTION
+        lazy_collect();
+#else
+        //do nothing. expired descriptors are collected at tick
+#endif
+    }
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    print_memory_consumption();
+#endif
+    
+    MICROBENCHMARK_STOP
+    MICROBENCHMARK_DURATION("scm_global_refresh")
+}
+
+extern __typeof__(scm_global_refresh) scm_global_refresh_internal
+    __attribute__((weak, alias("scm_global_refresh"), visibility("hidden")));
+
+/**
+ * scm_retire() is scm_global_refresh(ptr, 0): the descriptor is inserted
+ * two slots ahead in the globally clocked buffer, so it expires after the
+ * global time advanced twice, i.e. after every thread that participates
+ * in the global time ticked at least once in between.
+ */
+void scm_retire(void *ptr) {
+    scm_global_refresh_internal(ptr, 0);
+}
+
+/**
+ * scm_refresh_region_with_clock() refreshes a given region with a given
+ * clock, which can be different from the thread-local base clock.
+ * If a region is refreshed with multiple clocks it lives
+ * until all clocks ticked n times, where n is the respective extension.
+ */
+void scm_refresh_region_with_clock(const int region_index, unsigned int extension, const unsigned int clock) {
+
+    if (region_index < 0 || region_index >= SCM_MAX_REGIONS) {
+#ifdef SCM_DEBUG
+        printf("Region index is invalid.\n");
+#endif
+        return;
+    }
+
+    extension = check_extension(extension);
+
+    if (!valid_clock(clock)) {
+#ifdef SCM_DEBUG
+        printf("Clock is invalid.\n");
+#endif
+        return;
+    }
+
+    create_descriptor_root();
+
+    region_t* region = &descriptor_root->regions[region_index];
+
+    if (region->dc >= PINNED_BIAS) {
+#ifdef SCM_DEBUG
+        printf("Region is pinned or its descriptor counter reached "
+                "max value.\n");
+#endif
+        return;
+    }
+
+#ifdef SCM_CHECK_CONDITIONS
+    if (descriptor_root->current_time !=
+            descriptor_root->locally_clocked_reg_buffer[clock].age ||
+            descriptor_root->locally_clocked_reg_buffer[clock]
+            .not_expired_length == 0) {
+        printf("Cannot refresh zombie or uninitialized clock.\n");
+        return;
+    }
+#endif
+
+    refresh_region(region, extension, clock);
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    print_memory_consumption();
+#endif
+}
+
+extern __typeof__(scm_refresh_region_with_clock)
+    scm_refresh_region_with_clock_internal
+    __attribute__((weak, alias("scm_refresh_region_with_clock"),
+                visibility("hidden")));
+
+/**
+ * scm_refresh_region() adds extension time units to
+ * the expiration time of a region.
+ * In a multi-clock environment, scm_refresh refreshes
+ * the region with the thread-local base clock.
+ */
+void scm_refresh_region(const int region_index, unsigned int extension) {
+    scm_refresh_region_with_clock_internal(region_index, extension, 0);
+}
+
+/**
+ * scm_global_refresh_region() adds extension time units + 2 to
+ * the expiration time of a region making sure that all other threads have
+ * enough time to also call scm_global_refresh_region(region_id, extension).
+ */
+void scm_global_refresh_region(const int region_index, unsigned int extension) {
+    MICROBENCHMARK_START
+
+    if (region_index < 0 || region_index >= SCM_MAX_REGIONS) {
+#ifdef SCM_DEBUG
+        printf("Region index is invalid.\n");
+#endif
+        return;
+    }
+
+    extension = check_extension(extension);
+
+    create_descriptor_root();
+
+    region_t* region = &(descriptor_root->regions[region_index]);
+
+    if (region->dc >= PINNED_BIAS) {
+#ifdef SCM_DEBUG
+        printf("Region is pinned or its descriptor counter reached "
+                "max value.\n");
+#endif
+        return;
+    }
+
+    atomic_int_inc((int*) &region->dc);
+    insert_descriptor(region,
+                      &descriptor_root->globally_clocked_reg_buffer, extension + 2);
+
+#ifndef SCM_EAGER_COLLECTION
+    lazy_collect();
+#else
+    //do nothing. expired descriptors are collected at tick
+#endif
+
+#ifdef SCM_RECORD_MEMORY_USAGE
+    print_memory_consumption();
+#endif
+
+    MICROBENCHMARK_STOP
+    MICROBENCHMARK_DURATION("scm_global_refresh_region")
+}
+
+/**
+ * scm_malloc_for() allocates an object that expires after extension ticks
+ * of the clock without creating a descriptor. The object is bump-allocated
+ * into the tick arena of the slot in which a descriptor of
+ * scm_refresh_with_clock(ptr, extension, clock) would be inserted, and the
+ * arena is released when the slot expires. Objects that do not fit into a
+ * region page are allocated by scm_malloc and refreshed instead.
+ */
+void *scm_malloc_for(size_t size, unsigned int extension,
+        const unsigned int clock) {
+    extension = check_extension(extension);
+
+    if (!valid_clock(clock)) {
+#ifdef SCM_DEBUG
+        printf("Clock is invalid.\n");
+#endif
+        return NULL;
+    }
+
+    if (size > SCM_REGION_PAGE_PAYLOAD_SIZE - sizeof(object_header_t)) {
+        void *ptr = __wrap_malloc_internal(size);
+
+        if (ptr == NULL) return NULL;
+
+#ifdef SCM_MEMORY_BUDGETS
+        //the refresh charges the usable size, which is known only now
+        create_descriptor_root();
+
+        if (!allocation_fits_budget(clock, object_bytes(OBJECT_HEADER(ptr)))) {
+            __wrap_free_internal(ptr);
+            errno = ENOMEM;
+            return NULL;
+        }
+#endif
+
+        scm_refresh_with_clock_internal(ptr, extension, clock);
+        return ptr;
+    }
+
+    create_descriptor_root();
+
+    descriptor_buffer_t *buffer =
+        &descriptor_root->locally_clocked_obj_buffer[clock];
+
+#ifdef SCM_CHECK_CONDITIONS
+    if (descriptor_root->current_time != buffer->age ||
+            buffer->not_expired_length == 0) {
+        printf("Cannot allocate for zombie clock.\n");
+        return NULL;
+    }
+#endif
+
+    unsigned int needed_space = CACHEALIGN(size + sizeof(object_header_t));
+
+#ifdef SCM_MEMORY_BUDGETS
+    if (!allocation_fits_budget(clock, needed_space)) return NULL;
+
+    //the object does not exist yet, so the clock may tick
+    extension = charge_budgets(clock, extension, needed_space);
+#endif
+
+    tick_arena_t *arena = &descriptor_root->tick_arenas[clock][
+        (buffer->current_index + extension) % buffer->not_expired_length];
+
+    if (arena->first_page == NULL || arena->next_free_address + needed_space
+            > arena->last_address_in_first_page) {
+        if (new_tick_arena_page(arena) == NULL) return NULL;
+    }
+
+    object_header_t *object = (object_header_t*) arena->next_free_address;
+    arena->next_free_address += needed_space;
+
+    object->dc_or_region_id = TICK_ARENA_OBJECT;
+    object->finalizer_index = needed_space - sizeof(object_header_t);
+    //the space is released with the tick arena
+    if (SET_OBJECT_OWNER(object, 0) != 0) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    return PAYLOAD_OFFSET(object);
+}
+
+/**
+ * pin_counter() adds PINNED_BIAS to the descriptor counter dc unless it is
+ * pinned already. Returns zero if dc was pinned before.
+ */
+static int pin_counter(volatile int *dc) {
+    int old_dc = *dc;
+
+    while (old_dc < PINNED_BIAS) {
+        int seen = atomic_int_compare_and_exchange(dc, old_dc,
+                old_dc + PINNED_BIAS);
+
+        if (seen == old_dc) return 1;
+
+        old_dc = seen;
+    }
+
+    return 0;
+}
+
+/**
+ * unpin_counter() removes PINNED_BIAS from the descriptor counter dc if it
+ * is pinned. Returns zero if dc was not pinned.
+ */
+static int unpin_counter(volatile int *dc) {
+    int old_dc = *dc;
+
+    while (old_dc >= PINNED_BIAS && old_dc != TICK_ARENA_OBJECT) {
+        int seen = atomic_int_compare_and_exchange(dc, old_dc,
+                old_dc - PINNED_BIAS);
+
+        if (seen == old_dc) return 1;
+
+        old_dc = seen;
+    }
+
+    return 0;
+}
+
+/**
+ * pinned_counter() returns the descriptor counter that scm_pin and
+ * scm_unpin operate on: the counter of the object or, if the object is part
+ * of a region, the counter of the region.
+ */
+static volatile int *pinned_counter(void *ptr) {
+    object_header_t* object = OBJECT_HEADER(ptr);
+
+    if (object->dc_or_region_id < 0) {
+        create_descriptor_root();
+
+        return (volatile int*) &descriptor_root->regions[
+            object->dc_or_region_id & ~HB_MASK].dc;
+    }
+
+    return &object->dc_or_region_id;
+}
+
+/**
+ * Stores the parameters of a lifetime class and publishes them with a new
+ * version. The caller holds lifetime_classes_lock.
+ */
+static void set_lifetime_class(lifetime_class_t *lifetime_class,
+        unsigned int extension, const unsigned int clock) {
+    if (extension > SCM_MAX_EXPIRATION_EXTENSION) {
+        extension = SCM_MAX_EXPIRATION_EXTENSION;
+    }
+
+    atomic_long_store_release(&lifetime_class->extension, extension);
+    atomic_long_store_release(&lifetime_class->clock, clock);
+    atomic_long_store_release(&lifetime_class->version,
+            lifetime_class->version + 1);
+}
+
+const int scm_lifetime_class(const char *name, unsigned int extension,
+        const unsigned int clock) {
+    int i;
+
+    if (name == NULL || clock >= SCM_MAX_CLOCKS) {
+#ifdef SCM_DEBUG
+        printf("Lifetime class is invalid.\n");
+#endif
+        return -1;
+    }
+
+    pthread_mutex_lock(&lifetime_classes_lock);
+
+    for (i = 0; i < number_of_lifetime_classes; i++) {
+        if (strcmp(lifetime_classes[i].name, name) == 0) {
+            pthread_mutex_unlock(&lifetime_classes_lock);
+            return i;
+        }
+    }
+
+    char *copy = NULL;
+
+    if (number_of_lifetime_classes < SCM_MAX_LIFETIME_CLASSES) {
+        copy = __real_malloc(strlen(name) + 1);
+    }
+
+    if (copy == NULL) {
+        pthread_mutex_unlock(&lifetime_classes_lock);
+#ifdef SCM_DEBUG
+        printf("No lifetime class available.\n");
+#endif
+        return -1;
+    }
+
+    strcpy(copy, name);
+
+    lifetime_class_t *lifetime_class =
+        &lifetime_classes[number_of_lifetime_classes];
+
+    lifetime_class->name = copy;
+    set_lifetime_class(lifetime_class, extension, clock);
+
+    i = number_of_lifetime_classes++;
+
+    pthread_mutex_unlock(&lifetime_classes_lock);
+
+    return i;
+}
+
+void scm_lifetime_class_set(const int lifetime_class, unsigned int extension,
+        const unsigned int clock) {
+    if (lifetime_class < 0 || lifetime_class >= SCM_MAX_LIFETIME_CLASSES ||
+            clock >= SCM_MAX_CLOCKS) {
+#ifdef SCM_DEBUG
+        printf("Lifetime class is invalid.\n");
+#endif
+        return;
+    }
+
+    pthread_mutex_lock(&lifetime_classes_lock);
+
+    if (lifetime_class < number_of_lifetime_classes) {
+        set_lifetime_class(&lifetime_classes[lifetime_class], extension,
+                clock);
+    }
+
+    pthread_mutex_unlock(&lifetime_classes_lock);
+}
+
+/**
+ * Validates the parameters of a lifetime class for the heap and the clocks
+ * of the descriptor root and caches them with the version they belong to.
+ */
+static void cache_lifetime_class(lifetime_cache_t *cache,
+        lifetime_class_t *lifetime_class, long version) {
+    unsigned int clock =
+        atomic_long_load_acquire(&lifetime_class->clock);
+
+    cache->version = version;
+    cache->max_extension = descriptor_root->heap->max_extension;
+    cache->extension = check_extension(
+            atomic_long_load_acquire(&lifetime_class->extension));
+    cache->clock = clock;
+    //the clock must be registered by the thread, otherwise its buffer is a
+    //zombie or was never initialized
+    cache->valid = clock < descriptor_root->heap->max_clocks
+        && descriptor_root->locally_clocked_obj_buffer[clock].age ==
+            descriptor_root->current_time;
+}
+
+/**
+ * Makes the calling thread validate every lifetime class again on its
+ * next use, e.g. after one of its clocks was registered or unregistered.
+ */
+static void invalidate_lifetime_classes(void) {
+    int i;
+
+    for (i = 0; i < SCM_MAX_LIFETIME_CLASSES; i++) {
+        descriptor_root->lifetime_classes[i].version = 0;
+        descriptor_root->lifetime_classes[i].valid = false;
+    }
+}
+
+/**
+ * Returns the validated parameters of a lifetime class for the calling
+ * thread, which has a descriptor root, or NULL if the class is invalid.
+ * The parameters are only validated again when the class was retuned, the
+ * limit of the heap changed or the thread registered or unregistered a
+ * clock.
+ */
+static inline lifetime_cache_t *lifetime_parameters(const int lifetime_class) {
+    if ((unsigned int) lifetime_class >= SCM_MAX_LIFETIME_CLASSES) {
+        return NULL;
+    }
+
+    lifetime_cache_t *cache =
+        &descriptor_root->lifetime_classes[lifetime_class];
+    long version =
+        atomic_long_load_acquire(&lifetime_classes[lifetime_class].version);
+
+    if (__builtin_expect(cache->version != version ||
+            cache->max_extension != descriptor_root->heap->max_extension,
+            0)) {
+        cache_lifetime_class(cache, &lifetime_classes[lifetime_class],
+                version);
+    }
+
+    return cache->valid ? cache : NULL;
+}
+
+/**
+ * refresh_with_class() is the part of scm_refresh_class after the
+ * descriptor root exists.
+ */
+static inline void refresh_with_class(void *ptr, const int lifetime_class) {
+    lifetime_cache_t *cache = lifetime_parameters(lifetime_class);
+
+    if (cache == NULL) {
+#ifdef SCM_DEBUG
+        printf("Lifetime class is invalid.\n");
+#endif
+        return;
+    }
+
+    object_header_t *object = OBJECT_HEADER(ptr);
+
+    if (object->dc_or_region_id < 0) {
+        region_t *region = &descriptor_root->regions[
+            object->dc_or_region_id & ~HB_MASK];
+
+        if (region->dc < PINNED_BIAS) {
+            refresh_region(region, cache->extension, cache->clock);
+        }
+    } else if (object->dc_or_region_id < PINNED_BIAS) {
+        refresh_object(object, cache->extension, cache->clock);
+    }
+}
+
+void scm_refresh_class(void *ptr, const int lifetime_class) {
+    if (ptr == NULL) {
+#ifdef SCM_DEBUG
+        printf("Cannot refresh NULL pointer.\n");
+#endif
+        return;
+    }
+
+    create_descriptor_root();
+
+    refresh_with_class(ptr, lifetime_class);
+}
+
+void scm_refresh_region_class(const int region_index,
+        const int lifetime_class) {
+    if (region_index < 0 || region_index >= SCM_MAX_REGIONS) {
+#ifdef SCM_DEBUG
+        printf("Region index is invalid.\n");
+#endif
+        return;
+    }
+
+    create_descriptor_root();
+
+    lifetime_cache_t *cache = lifetime_parameters(lifetime_class);
+
+    if (cache == NULL) {
+#ifdef SCM_DEBUG
+        printf("Lifetime class is invalid.\n");
+#endif
+        return;
+    }
+
+    region_t *region = &descriptor_root->regions[region_index];
+
+    if (region->dc < PINNED_BIAS) {
+        refresh_region(region, cache->extension, cache->clock);
+    }
+}
+
+void *scm_malloc_class(size_t size, const int lifetime_class) {
+    create_descriptor_root();
+
+    //without a valid class nothing would ever free the object
+    lifetime_cache_t *cache = lifetime_parameters(lifetime_class);
+
+    if (cache == NULL) {
+#ifdef SCM_DEBUG
+        printf("Lifetime class is invalid.\n");
+#endif
+        errno = EINVAL;
+        return NULL;
+    }
+
+    void *ptr = __wrap_malloc_internal(size);
+
+    if (ptr == NULL) return NULL;
+
+#ifdef SCM_MEMORY_BUDGETS
+    //the refresh charges the usable size, which is known only now
+    if (!allocation_fits_budget(cache->clock,
+            object_bytes(OBJECT_HEADER(ptr)))) {
+        __wrap_free_internal(ptr);
+        errno = ENOMEM;
+        return NULL;
+    }
+#endif
+
+    refresh_with_class(ptr, lifetime_class);
+
+    return ptr;
+}
+
+/**
+ * scm_pin() makes an object permanent. Descriptors of the object that exist
+ * already expire without freeing it and refreshing the object has no
+ * effect until it is unpinned. If the object is part of a region, the
+ * region is pinned instead.
  */
-void scm_global_refresh(void *ptr, unsigned int extension) {
-    MICROBENCHMARK_START
-    
+void scm_pin(void *ptr) {
     if (ptr == NULL) {
 #ifdef SCM_DEBUG
-        printf("Cannot refresh NULL pointer.\n");
+        printf("Cannot pin NULL pointer.\n");
 #endif
         return;
     }
 
-    object_header_t* object = OBJECT_HEADER(ptr);
-
-    if (object->dc_or_region_id < 0) {
-        int region_id = object->dc_or_region_id & ~HB_MASK;
-
-        scm_global_refresh_region(region_id, extension);
-    } else {
-        if (object->dc_or_region_id == INT_MAX) {
+    if (!pin_counter(pinned_counter(ptr))) {
 #ifdef SCM_DEBUG
-            printf("Descriptor counter reached max value.\n");
+        printf("Object or region is already pinned.\n");
 #endif
-            return;
-        }
-
-        extension = check_extension(extension);
-
-        create_descriptor_root();
-
-        atomic_int_inc((int*) &object->dc_or_region_id);
-        insert_descriptor(object,
-                          &descriptor_root->globally_clocked_obj_buffer, extension + 2);
+    }
+}
 
-#ifndef SCM_EAGER_COLLECTION
-        lazy_collect();
-#else
-        //do nothing. expired descriptors are collected at tick
+/**
+ * scm_unpin() returns a pinned object to short-term memory management.
+ * An object that was not refreshed while it was pinned is like a newly
+ * allocated object, i.e. it expires only after it has been refreshed.
+ * If the object is part of a region, the region is unpinned instead.
+ */
+void scm_unpin(void *ptr) {
+    if (ptr == NULL) {
+#ifdef SCM_DEBUG
+        printf("Cannot unpin NULL pointer.\n");
 #endif
+        return;
     }
 
-#ifdef SCM_RECORD_MEMORY_USAGE
-    print_memory_consumption();
+    if (!unpin_counter(pinned_counter(ptr))) {
+#ifdef SCM_DEBUG
+        printf("Object or region is not pinned.\n");
 #endif
-    
-    MICROBENCHMARK_STOP
-    MICROBENCHMARK_DURATION("scm_global_refresh")
+    }
 }
 
 /**
- * scm_refresh_region_with_clock() refreshes a given region with a given
- * clock, which can be different from the thread-local base clock.
- * If a region is refreshed with multiple clocks it lives
- * until all clocks ticked n times, where n is the respective extension.
+ * scm_lease() keeps an object alive on a clock until scm_lease_cancel is
+ * called, then it expires after period more ticks of the clock. The lease
+ * holds one descriptor counter increment and a table entry, so it costs
+ * nothing per tick. Leasing an object again changes the period. If the
+ * object is part of a region, the region is leased instead.
  */
-void scm_refresh_region_with_clock(const int region_index, unsigned int extension, const unsigned int clock) {
-
-    if (region_index < 0 || region_index >= SCM_MAX_REGIONS) {
+void scm_lease(void *ptr, unsigned int period, const unsigned int clock) {
+    if (ptr == NULL) {
 #ifdef SCM_DEBUG
-        printf("Region index is invalid.\n");
+        printf("Cannot lease NULL pointer.\n");
 #endif
         return;
     }
 
-    extension = check_extension(extension);
+    object_header_t *object = OBJECT_HEADER(ptr);
 
-    if (clock < 0 || clock >= SCM_MAX_CLOCKS) {
+    if (object->dc_or_region_id >= PINNED_BIAS) {
 #ifdef SCM_DEBUG
-        printf("Clock is invalid.\n");
+        printf("Object is pinned or allocated without descriptors.\n");
 #endif
         return;
     }
 
-    create_descriptor_root();
-
-    region_t* region = &descriptor_root->regions[region_index];
+    period = check_extension(period);
 
-    if (region->dc == INT_MAX) {
+    if (!valid_clock(clock)) {
 #ifdef SCM_DEBUG
-        printf("Region descriptor counter reached max value.\n");
+        printf("Clock is invalid.\n");
 #endif
         return;
     }
 
-#ifdef SCM_CHECK_CONDITIONS
-    if (descriptor_root->current_time !=
-            descriptor_root->locally_clocked_reg_buffer[clock].age ||
-            descriptor_root->locally_clocked_reg_buffer[clock]
-            .not_expired_length == 0) {
-        printf("Cannot refresh zombie or uninitialized clock.\n");
-        return;
-    }
-#endif
+    create_descriptor_root();
 
-    atomic_int_inc((int*) &region->dc);
-    insert_descriptor(region,
-                      &descriptor_root->locally_clocked_reg_buffer[clock], extension);
+    bool is_region = object->dc_or_region_id < 0;
+    void *target = is_region ? (void*) &descriptor_root->regions[
+        object->dc_or_region_id & ~HB_MASK] : (void*) object;
+    lease_table_t *table = &descriptor_root->leases[clock];
+    lease_t *lease = find_lease(table, target);
 
-#ifndef SCM_EAGER_COLLECTION
-    lazy_collect();
-#else
-    //do nothing. expired descriptors are collected at tick
-#endif
+    if (lease == NULL) {
+        lease = add_lease(table, target);
 
-#ifdef SCM_RECORD_MEMORY_USAGE
-    print_memory_consumption();
-#endif
-}
+        if (lease == NULL) return;
 
-/**
- * scm_refresh_region() adds extension time units to
- * the expiration time of a region.
- * In a multi-clock environment, scm_refresh refreshes
- * the region with the thread-local base clock.
- */
-void scm_refresh_region(const int region_index, unsigned int extension) {
-    scm_refresh_region_with_clock(region_index, extension, 0);
+        lease->region = is_region;
+
+        atomic_int_inc(is_region ? (int*) &((region_t*) target)->dc
+                : &object->dc_or_region_id);
+    }
+
+    lease->period = period;
 }
 
 /**
- * scm_global_refresh_region() adds extension time units + 2 to
- * the expiration time of a region making sure that all other threads have
- * enough time to also call scm_global_refresh_region(region_id, extension).
+ * scm_lease_cancel() ends the lease of an object on a clock. The object
+ * expires after the period of the lease unless it is refreshed.
  */
-void scm_global_refresh_region(const int region_index, unsigned int extension) {
-    MICROBENCHMARK_START
+void scm_lease_cancel(void *ptr, const unsigned int clock) {
+    if (ptr == NULL || descriptor_root == NULL) return;
 
-    if (region_index < 0 || region_index >= SCM_MAX_REGIONS) {
+    if (!valid_clock(clock)) {
 #ifdef SCM_DEBUG
-        printf("Region index is invalid.\n");
+        printf("Clock is invalid.\n");
 #endif
         return;
     }
 
-    extension = check_extension(extension);
-
-    create_descriptor_root();
-
-    region_t* region = &(descriptor_root->regions[region_index]);
+    object_header_t *object = OBJECT_HEADER(ptr);
+    void *target = object->dc_or_region_id < 0 ?
+        (void*) &descriptor_root->regions[object->dc_or_region_id & ~HB_MASK]
+        : (void*) object;
+    lease_table_t *table = &descriptor_root->leases[clock];
+    lease_t *lease = find_lease(table, target);
 
-    if (region->dc == INT_MAX) {
+    if (lease == NULL) {
 #ifdef SCM_DEBUG
-        printf("Region descriptor counter reached max value.\n");
+        printf("Object is not leased on this clock.\n");
 #endif
         return;
     }
 
-    atomic_int_inc((int*) &region->dc);
-    insert_descriptor(region,
-                      &descriptor_root->globally_clocked_reg_buffer, extension + 2);
+    unsigned int period = lease->period;
+    bool is_region = lease->region;
 
-#ifndef SCM_EAGER_COLLECTION
-    lazy_collect();
-#else
-    //do nothing. expired descriptors are collected at tick
-#endif
+    remove_lease(table, lease);
 
-#ifdef SCM_RECORD_MEMORY_USAGE
-    print_memory_consumption();
+#ifdef SCM_MEMORY_BUDGETS
+    //the lease holds the counter, so the clock may tick
+    period = charge_budgets(clock, period, is_region ?
+        region_bytes(target) : object_bytes(target));
 #endif
 
-    MICROBENCHMARK_STOP
-    MICROBENCHMARK_DURATION("scm_global_refresh_region")
+    //the descriptor takes over the counter increment of the lease
+    insert_descriptor(target, is_region ?
+        &descriptor_root->locally_clocked_reg_buffer[clock] :
+        &descriptor_root->locally_clocked_obj_buffer[clock], period);
 }
 
 /**
@@ -1083,6 +2904,92 @@ static void increment_and_expire_clock(const unsigned int clock) {
                   &descriptor_root->list_of_expired_obj_descriptors);
     expire_buffer(&descriptor_root->locally_clocked_reg_buffer[clock],
                   &descriptor_root->list_of_expired_reg_descriptors);
+
+    //the objects of scm_malloc_for in the expired slot are released at once
+    descriptor_buffer_t *buffer =
+        &descriptor_root->locally_clocked_obj_buffer[clock];
+    unsigned int expired_index = (buffer->current_index
+        + buffer->not_expired_length - 1) % buffer->not_expired_length;
+    tick_arena_t *arena =
+        &descriptor_root->tick_arenas[clock][expired_index];
+
+    if (arena->first_page != NULL) {
+        expire_tick_arena(arena);
+    }
+
+#ifdef SCM_MEMORY_BUDGETS
+    release_budget_slot(clock, expired_index);
+#endif
+}
+
+/**
+ * clean_up_zombie_buffer() visits the next locally clocked buffer in
+ * round-robin order (skipping the base clock and the just ticked clock) and,
+ * if it is a zombie of an unregistered clock, expires one more of its slots.
+ * The round robin advances on every call, so a zombie buffer is
+ * visited at least every SCM_MAX_CLOCKS - 1 ticks regardless of how many
+ * clocks are still registered.
+ */
+static void clean_up_zombie_buffer(const unsigned int ticked_clock) {
+    unsigned int rr_index = descriptor_root->round_robin;
+
+    if (rr_index == ticked_clock) {
+        rr_index = (rr_index + 1) % SCM_MAX_CLOCKS;
+        if (rr_index == 0) {
+            rr_index = 1;
+        }
+    }
+
+#ifdef SCM_CHECK_CONDITIONS
+    if (rr_index == 0 || rr_index >= SCM_MAX_CLOCKS) {
+        printf("The round-robin index = %u must never be 0 or >= SCM_MAX_CLOCKS.\n", rr_index);
+        exit(-1);
+    }
+#endif
+
+    unsigned int age_of_rr_buffer =
+        descriptor_root->locally_clocked_obj_buffer[rr_index].age;
+
+    // if the round_robin buffer is a zombie -> cleanup incrementally
+    if (age_of_rr_buffer != descriptor_root->current_time &&
+            descriptor_root->locally_clocked_obj_buffer[rr_index]
+            .not_expired_length != 0) {
+
+        increment_and_expire_clock(rr_index);
+    }
+
+    rr_index = (rr_index + 1) % SCM_MAX_CLOCKS;
+    if (rr_index == 0) {
+        rr_index = 1;
+    }
+    descriptor_root->round_robin = rr_index;
+}
+
+/**
+ * tick_clock() is the unchecked part of scm_tick_clock.
+ */
+static inline void tick_clock(const unsigned int clock) {
+    increment_and_expire_clock(clock);
+
+    if (descriptor_root->number_of_recycled_objects != 0) {
+        trim_recycle_cache();
+    }
+
+    if (descriptor_root->rings != NULL) {
+        tick_rings(clock);
+    }
+
+    if (SCM_MAX_CLOCKS > 1) {
+        clean_up_zombie_buffer(clock);
+    }
+
+#ifdef SCM_EAGER_COLLECTION
+    eager_collect();
+#else
+    //we also process expired descriptors at tick
+    //to get a cyclic allocation/free scheme. this is optional
+    lazy_collect();
+#endif
 }
 
 /**
@@ -1096,7 +3003,7 @@ void scm_tick_clock(const unsigned int clock) {
         return;
     }
 
-    if (clock < 0 || clock >= SCM_MAX_CLOCKS) {
+    if (!valid_clock(clock)) {
 #ifdef SCM_DEBUG
         printf("Clock is invalid.\n");
 #endif
@@ -1107,63 +3014,117 @@ void scm_tick_clock(const unsigned int clock) {
     printf("Ticking clock: %d.\n", clock);
 #endif
 
-    increment_and_expire_clock(clock);
-
-    if (SCM_MAX_CLOCKS > 1) {
-        unsigned int rr_index = descriptor_root->round_robin;
-        if (rr_index == clock) {
-            rr_index = (rr_index + 1) % SCM_MAX_CLOCKS;
-            if (rr_index == 0) {
-                rr_index = 1;
-            }
-        }
+    tick_clock(clock);
 
-#ifdef SCM_CHECK_CONDITIONS
-        if (rr_index == 0 || rr_index >= SCM_MAX_CLOCKS) {
-            printf("The round-robin index is %u.\n", rr_index);
-            exit(-1);
-        }
+#ifdef SCM_RECORD_MEMORY_USAGE
+    print_memory_consumption();
 #endif
 
-        unsigned int age_of_rr_buffer =
-            descriptor_root->locally_clocked_obj_buffer[rr_index].age;
+    MICROBENCHMARK_STOP
+    MICROBENCHMARK_DURATION("scm_tick_clock")
+}
 
-        // if the next round_robin buffer is a zombie -> cleanup incrementally
-        if ( age_of_rr_buffer != descriptor_root->current_time &&
-            descriptor_root->locally_clocked_obj_buffer[rr_index]
-                .not_expired_length != 0) {
+extern __typeof__(scm_tick_clock) scm_tick_clock_internal
+    __attribute__((weak, alias("scm_tick_clock"), visibility("hidden")));
 
-            increment_and_expire_clock(rr_index);
+/**
+ * scm_tick advances the local time of the calling thread
+ */
+inline void scm_tick(void) {
+    scm_tick_clock_internal(0);
+}
 
-            rr_index = (rr_index + 1) % SCM_MAX_CLOCKS;
-            if (rr_index == 0) {
-                rr_index = 1;
-            }
-            descriptor_root->round_robin = rr_index;
-        }
+void scm_set_clock_budget(const unsigned int clock, size_t bytes,
+        int policy) {
+#ifdef SCM_MEMORY_BUDGETS
+    if (!valid_clock(clock) || policy < SCM_BUDGET_TICK ||
+            policy > SCM_BUDGET_FAIL) {
+#ifdef SCM_DEBUG
+        printf("Memory budget is invalid.\n");
+#endif
+        return;
     }
 
-#ifdef SCM_EAGER_COLLECTION
-    eager_collect();
+    create_descriptor_root();
+
+    descriptor_root->clock_budgets[clock].limit = bytes;
+    descriptor_root->clock_budgets[clock].policy = policy;
 #else
-    //we also process expired descriptors at tick
-    //to get a cyclic allocation/free scheme. this is optional
-    lazy_collect();
+#ifdef SCM_DEBUG
+    printf("libscm was built without SCM_MEMORY_BUDGETS.\n");
+#endif
 #endif
+}
 
-#ifdef SCM_RECORD_MEMORY_USAGE
-    print_memory_consumption();
+void scm_set_thread_budget(size_t bytes, int policy) {
+#ifdef SCM_MEMORY_BUDGETS
+    if (policy < SCM_BUDGET_TICK || policy > SCM_BUDGET_FAIL) {
+#ifdef SCM_DEBUG
+        printf("Memory budget is invalid.\n");
 #endif
+        return;
+    }
 
-    MICROBENCHMARK_STOP
-    MICROBENCHMARK_DURATION("scm_tick_clock")
+    create_descriptor_root();
+
+    descriptor_root->thread_budget.limit = bytes;
+    descriptor_root->thread_budget.policy = policy;
+#else
+#ifdef SCM_DEBUG
+    printf("libscm was built without SCM_MEMORY_BUDGETS.\n");
+#endif
+#endif
 }
 
-/**
- * scm_tick advances the local time of the calling thread
+size_t scm_clock_usage(const unsigned int clock) {
+#ifdef SCM_MEMORY_BUDGETS
+    if (descriptor_root == NULL || !valid_clock(clock)) {
+        return 0;
+    }
+
+    return descriptor_root->clock_budgets[clock].used;
+#else
+    return 0;
+#endif
+}
+
+size_t scm_thread_usage(void) {
+#ifdef SCM_MEMORY_BUDGETS
+    if (descriptor_root == NULL) return 0;
+
+    return descriptor_root->thread_budget.used;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Unchecked variants, see libscm_fast.h
  */
-inline void scm_tick(void) {
-    scm_tick_clock(0);
+
+void scm_refresh_fast(void *ptr, unsigned int extension,
+        const unsigned int clock) {
+    object_header_t* object = OBJECT_HEADER(ptr);
+
+    if (__builtin_expect(object->dc_or_region_id < 0, 0)) {
+        refresh_region(&descriptor_root->regions[
+                object->dc_or_region_id & ~HB_MASK], extension, clock);
+    } else if (__builtin_expect(object->dc_or_region_id < PINNED_BIAS, 1)) {
+        refresh_object(object, extension, clock);
+    }
+}
+
+void scm_refresh_region_fast(const int region_index, unsigned int extension,
+        const unsigned int clock) {
+    region_t* region = &descriptor_root->regions[region_index];
+
+    if (__builtin_expect(region->dc < PINNED_BIAS, 1)) {
+        refresh_region(region, extension, clock);
+    }
+}
+
+void scm_tick_fast(const unsigned int clock) {
+    tick_clock(clock);
 }
 
 /**
@@ -1176,7 +3137,10 @@ void scm_global_tick(void) {
         return;
     }
 
-    if (global_time == descriptor_root->global_phase) {
+    scm_heap_t *heap = descriptor_root->heap;
+
+    if (atomic_long_load_acquire(&heap->global_time)
+            == descriptor_root->global_phase) {
 
         //each thread must expire its own globally clocked buffer,
         //but can only do so on its first tick after the last global
@@ -1196,17 +3160,19 @@ void scm_global_tick(void) {
         expire_buffer(&descriptor_root->globally_clocked_reg_buffer,
                       &descriptor_root->list_of_expired_reg_descriptors);
 
-        if (atomic_int_dec_and_test((int*) &ticked_threads_countdown)) {
+        if (atomic_int_dec_and_test((int*) &heap->ticked_threads_countdown)) {
             // we are the last thread to tick in this global phase
             
-            lock_global_time();
+            lock_global_time(heap);
 
-            ticked_threads_countdown = number_of_threads;
+            heap->ticked_threads_countdown = heap->number_of_threads;
             
             //assert: descriptor_root->global_phase == global_time + 1
-            global_time++;
+            //the countdown is reset before other threads see the new time
+            atomic_long_store_release(&heap->global_time,
+                    heap->global_time + 1);
 
-            unlock_global_time();
+            unlock_global_time(heap);
 
         } //else global_time does not advance, other threads have to do a global_tick
 
@@ -1214,33 +3180,8 @@ void scm_global_tick(void) {
 
 
     if (SCM_MAX_CLOCKS > 1) {
-
-        unsigned int rr_index = descriptor_root->round_robin;
-
-#ifdef SCM_CHECK_CONDITIONS
-        if (rr_index == 0 || rr_index >= SCM_MAX_CLOCKS) {
-            printf("The round-robin index = %u must never be 0 or >= SCM_MAX_CLOCKS.\n", rr_index);
-            return;
-        }
-#endif
-        unsigned int age_of_rr_buffer =
-            descriptor_root->locally_clocked_obj_buffer[rr_index].age;
-
-        // if the next round_robin buffer is a zombie -> cleanup incrementally
-        if (age_of_rr_buffer != descriptor_root->current_time &&
-                descriptor_root->locally_clocked_obj_buffer[rr_index]
-                .not_expired_length != 0) {
-
-            increment_and_expire_clock(rr_index);
-
-            rr_index = (rr_index + 1) % SCM_MAX_CLOCKS;
-            
-            if (rr_index == 0) {
-                rr_index = 1;
-            }
-            
-            descriptor_root->round_robin = rr_index;
-        }
+        // the base clock is never visited by the round robin
+        clean_up_zombie_buffer(0);
     }
 
 #ifdef SCM_EAGER_COLLECTION
@@ -1255,4 +3196,26 @@ void scm_global_tick(void) {
 
     MICROBENCHMARK_STOP
     MICROBENCHMARK_DURATION("scm_global_tick")
+}
+
+extern __typeof__(scm_global_tick) scm_global_tick_internal
+    __attribute__((weak, alias("scm_global_tick"), visibility("hidden")));
+
+/**
+ * scm_quiescent() only does the work of scm_global_tick if the thread has
+ * not ticked in the current global period yet, otherwise it is a single
+ * load of the global time.
+ */
+void scm_quiescent(void) {
+    if (descriptor_root == NULL || descriptor_root->blocked) {
+        return;
+    }
+
+    if (atomic_long_load_acquire(&descriptor_root->heap->global_time)
+            != descriptor_root->global_phase) {
+        //ticked already in this global period
+        return;
+    }
+
+    scm_global_tick_internal();
 }
\ No newline at end of file
@@ -10,6 +10,10 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
 
 #include <pthread.h>
 #include <limits.h>
@@ -18,7 +22,10 @@
 #include "arch.h"
 #include "object.h"
 #include "descriptors.h"
+#include "pool.h"
+#include "ring.h"
 #include "libscm.h"
+#include "libscm_fast.h"
 
 #ifdef SCM_MAKE_MICROBENCHMARKS
 #define MICROBENCHMARK_START unsigned long long _mb_start = rdtsc();
@@ -33,6 +40,11 @@
 
 #define HB_MASK (UINT_MAX - INT_MAX)
 
+// added to the descriptor counter of pinned objects and regions, see scm_pin.
+// Counters at or above the bias are not refreshed, so an object or region
+// holds at most PINNED_BIAS - 1 descriptors.
+#define PINNED_BIAS (1 << 30)
+
 #define CACHEALIGN(x) (ROUND_UP(x,8))
 #define ROUND_UP(x,y) (ROUND_DOWN(x+(y-1),y))
 #define ROUND_DOWN(x,y) ((x) & ~(y-1))
@@ -0,0 +1,702 @@
+/*
+ * Copyright (c) 2010, the Short-term Memory Project Authors.
+ * All rights reserved. Please see the AUTHORS file for details.
+ * Use of this source code is governed by a BSD license that
+ * can be found in the LICENSE file.
+ */
+
+#ifndef _SCM_HPP_
+#define	_SCM_HPP_
+
+/*
+ * C++ allocators over libscm.
+ *
+ * region_allocator<T> and region_resource place the storage of standard
+ * containers into a region: allocation is a bump of the region pointer and
+ * deallocation does nothing, the memory is reclaimed when the region
+ * expires. Containers built per request may therefore be abandoned without
+ * running their destructors, as long as they are not used after the region
+ * expired.
+ *
+ * Blocks that do not fit into a region page (see SCM_REGION_PAGE_SIZE) or
+ * need a larger alignment than region objects provide are taken from an
+ * upstream allocator instead and returned to it on deallocation, so only
+ * containers with small blocks may skip their destructors.
+ *
+ * short_term_allocator<T> and short_term_resource allocate every block as
+ * a short-term object that is refreshed on allocation with the extension
+ * and clock of the allocator. A block expires after extension ticks of the
+ * clock unless the application refreshes it again, deallocation does
+ * nothing. A container must be destroyed, if at all, before its blocks
+ * expire, since its destructor reads them.
+ *
+ * short_term_ptr<T, Extension, Clock> is a pointer that refreshes its
+ * object on construction with an extension and a clock that are template
+ * arguments, so it compiles to the scm_refresh_with_clock call a C program
+ * would make. make_short_term<T>() allocates and constructs an object whose
+ * destructor runs as its finalizer when it expires.
+ *
+ * tick_scope and blocked_scope tick the clock at the end of a scope and
+ * block the thread from the global time for the duration of a scope.
+ *
+ * heap<MaxExtension, Clocks>::instance() returns an independent heap with
+ * limits that are checked at compile time, heap_scope switches the calling
+ * thread to a heap for the duration of a scope.
+ *
+ * short_term_promise<Clock> is a mixin for the promise types of C++20
+ * coroutines: the coroutine frame is allocated by libscm, every co_await
+ * in the coroutine ticks Clock and each coroutine has a region for the
+ * memory of its request, see below.
+ *
+ * The resources need C++17 (<memory_resource>), the coroutine support
+ * C++20, everything else C++11.
+ */
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 201703L && defined __has_include
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define SCM_HAS_MEMORY_RESOURCE
+#endif
+#endif
+
+#if __cplusplus >= 202002L && defined __cpp_impl_coroutine
+#if __has_include(<coroutine>)
+#include <coroutine>
+#define SCM_HAS_COROUTINES
+#endif
+#endif
+
+#include "libscm.h"
+
+namespace scm {
+
+// the payload of short-term objects and region objects is aligned to
+// 8 bytes behind the object header
+constexpr std::size_t payload_alignment = 8;
+
+// larger blocks do not fit into a region page next to the page link and
+// the object header
+constexpr std::size_t max_region_block = SCM_REGION_PAGE_SIZE - 32;
+
+inline bool fits_into_region(std::size_t bytes, std::size_t alignment) {
+    return bytes <= max_region_block && alignment <= payload_alignment;
+}
+
+/**
+ * Allocates a block in the region, throws std::bad_alloc if the region
+ * cannot provide it.
+ */
+inline void *region_allocate(int region, std::size_t bytes) {
+    void *p = scm_malloc_in_region(bytes, region);
+
+    if (p == nullptr) throw std::bad_alloc();
+
+    return p;
+}
+
+/**
+ * Allocates a short-term object that expires after extension ticks of the
+ * clock, throws std::bad_alloc if out of memory.
+ */
+inline void *short_term_allocate(std::size_t bytes, unsigned int extension,
+        unsigned int clock) {
+    void *p = scm_malloc(bytes);
+
+    if (p == nullptr) throw std::bad_alloc();
+
+    scm_refresh_with_clock(p, extension, clock);
+
+    return p;
+}
+
+/**
+ * Allocator of the objects of a region, which is created with
+ * scm_create_region and refreshed by the application.
+ */
+template <typename T>
+class region_allocator {
+public:
+    typedef T value_type;
+
+    explicit region_allocator(int region) noexcept : region_(region) {}
+
+    template <typename U>
+    region_allocator(const region_allocator<U> &other) noexcept
+        : region_(other.region()) {}
+
+    T *allocate(std::size_t n) {
+        if (n > max_size()) throw std::bad_alloc();
+
+        std::size_t bytes = n * sizeof(T);
+
+        if (!fits_into_region(bytes, alignof(T))) {
+            return static_cast<T*>(::operator new(bytes));
+        }
+
+        return static_cast<T*>(region_allocate(region_, bytes));
+    }
+
+    void deallocate(T *p, std::size_t n) noexcept {
+        if (!fits_into_region(n * sizeof(T), alignof(T))) {
+            ::operator delete(p);
+        }
+        //else: released with the region
+    }
+
+    std::size_t max_size() const noexcept {
+        return std::numeric_limits<std::size_t>::max() / sizeof(T);
+    }
+
+    int region() const noexcept {
+        return region_;
+    }
+
+private:
+    int region_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const region_allocator<T> &a,
+        const region_allocator<U> &b) noexcept {
+    return a.region() == b.region();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const region_allocator<T> &a,
+        const region_allocator<U> &b) noexcept {
+    return !(a == b);
+}
+
+/**
+ * Allocator of short-term objects that expire after extension ticks of
+ * the clock.
+ */
+template <typename T>
+class short_term_allocator {
+public:
+    typedef T value_type;
+
+    explicit short_term_allocator(unsigned int extension = 0,
+            unsigned int clock = 0) noexcept
+        : extension_(extension), clock_(clock) {}
+
+    template <typename U>
+    short_term_allocator(const short_term_allocator<U> &other) noexcept
+        : extension_(other.extension()), clock_(other.clock()) {}
+
+    T *allocate(std::size_t n) {
+        static_assert(alignof(T) <= payload_alignment,
+            "short-term objects are aligned to 8 bytes");
+
+        if (n > max_size()) throw std::bad_alloc();
+
+        return static_cast<T*>(
+            short_term_allocate(n * sizeof(T), extension_, clock_));
+    }
+
+    void deallocate(T *, std::size_t) noexcept {
+        //the block expires with its descriptor
+    }
+
+    std::size_t max_size() const noexcept {
+        return std::numeric_limits<std::size_t>::max() / sizeof(T);
+    }
+
+    unsigned int extension() const noexcept {
+        return extension_;
+    }
+
+    unsigned int clock() const noexcept {
+        return clock_;
+    }
+
+private:
+    unsigned int extension_;
+    unsigned int clock_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const short_term_allocator<T> &a,
+        const short_term_allocator<U> &b) noexcept {
+    return a.extension() == b.extension() && a.clock() == b.clock();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const short_term_allocator<T> &a,
+        const short_term_allocator<U> &b) noexcept {
+    return !(a == b);
+}
+
+/**
+ * Pointer to a short-term object that refreshes the object with Extension
+ * and Clock whenever a short_term_ptr to it is constructed or refresh()
+ * is called. Destruction does nothing, the object expires when its
+ * descriptors expired.
+ */
+template <typename T, unsigned int Extension = 0, unsigned int Clock = 0>
+class short_term_ptr {
+    static_assert(Extension <= SCM_MAX_EXPIRATION_EXTENSION,
+        "extension exceeds SCM_MAX_EXPIRATION_EXTENSION");
+
+public:
+    typedef T element_type;
+
+    short_term_ptr() noexcept : ptr_(nullptr) {}
+
+    explicit short_term_ptr(T *ptr) noexcept : ptr_(ptr) {
+        refresh();
+    }
+
+    short_term_ptr(const short_term_ptr &other) noexcept : ptr_(other.ptr_) {
+        refresh();
+    }
+
+    short_term_ptr &operator=(const short_term_ptr &other) noexcept {
+        ptr_ = other.ptr_;
+        refresh();
+        return *this;
+    }
+
+    void refresh() const noexcept {
+        //scm_refresh_with_clock ignores NULL
+        scm_refresh_with_clock(ptr_, Extension, Clock);
+    }
+
+    T *get() const noexcept {
+        return ptr_;
+    }
+
+    T &operator*() const noexcept {
+        return *ptr_;
+    }
+
+    T *operator->() const noexcept {
+        return ptr_;
+    }
+
+    explicit operator bool() const noexcept {
+        return ptr_ != nullptr;
+    }
+
+private:
+    T *ptr_;
+};
+
+/**
+ * Finalizer that runs the destructor of an expired object of type T.
+ */
+template <typename T>
+int destroy_finalizer(void *ptr) {
+    static_cast<T*>(ptr)->~T();
+    return 0;
+}
+
+/**
+ * Registers the destructor of T as finalizer, throws std::bad_alloc if the
+ * finalizer table is full.
+ */
+template <typename T>
+int register_destructor_finalizer() {
+    int id = scm_register_finalizer(&destroy_finalizer<T>);
+
+    if (id == -1) throw std::bad_alloc();
+
+    return id;
+}
+
+/**
+ * Returns the finalizer id of the destructor of T, which is registered on
+ * the first call for each type. Throws std::bad_alloc if the finalizer
+ * table is full, the next call tries again.
+ */
+template <typename T>
+int destructor_finalizer_id() {
+    static const int id = register_destructor_finalizer<T>();
+    return id;
+}
+
+/**
+ * Allocates and constructs a short-term object of type T and refreshes it
+ * with Extension and Clock. The destructor of T runs when the object
+ * expires, unless T is trivially destructible. Throws std::bad_alloc if
+ * out of memory or if the destructor of T cannot be registered as
+ * finalizer, and whatever the constructor of T throws.
+ */
+template <typename T, unsigned int Extension = 0, unsigned int Clock = 0,
+        typename... Args>
+short_term_ptr<T, Extension, Clock> make_short_term(Args&&... args) {
+    static_assert(alignof(T) <= payload_alignment,
+        "short-term objects are aligned to 8 bytes");
+
+    //before anything is allocated, so a full finalizer table leaks nothing
+    const int finalizer_id = std::is_trivially_destructible<T>::value ?
+        -1 : destructor_finalizer_id<T>();
+
+    void *p = scm_malloc(sizeof(T));
+
+    if (p == nullptr) throw std::bad_alloc();
+
+    T *object;
+
+    try {
+        object = new (p) T(std::forward<Args>(args)...);
+    } catch (...) {
+        scm_free(p);
+        throw;
+    }
+
+    if (finalizer_id != -1) {
+        scm_set_finalizer(object, finalizer_id);
+    }
+
+    return short_term_ptr<T, Extension, Clock>(object);
+}
+
+/**
+ * Ticks the clock when the scope ends.
+ */
+class tick_scope {
+public:
+    explicit tick_scope(unsigned int clock = 0) noexcept : clock_(clock) {}
+
+    ~tick_scope() {
+        scm_tick_clock(clock_);
+    }
+
+    tick_scope(const tick_scope &) = delete;
+    tick_scope &operator=(const tick_scope &) = delete;
+
+private:
+    unsigned int clock_;
+};
+
+/**
+ * Blocks the calling thread from the global time for the duration of the
+ * scope, e.g. around a blocking system call (see scm_block_thread).
+ */
+class blocked_scope {
+public:
+    blocked_scope() noexcept {
+        scm_block_thread();
+    }
+
+    ~blocked_scope() {
+        scm_resume_thread();
+    }
+
+    blocked_scope(const blocked_scope &) = delete;
+    blocked_scope &operator=(const blocked_scope &) = delete;
+};
+
+/**
+ * An independent heap (see scm_heap_create) whose refresh calls accept
+ * extensions up to MaxExtension and which has Clocks clocks per thread,
+ * including the base clock. Heaps are never destroyed and take one of
+ * SCM_MAX_HEAPS entries, so there is one heap per combination of limits,
+ * created by the first call of instance().
+ */
+template <unsigned int MaxExtension = SCM_MAX_EXPIRATION_EXTENSION,
+        unsigned int Clocks = SCM_MAX_CLOCKS>
+class heap {
+    static_assert(MaxExtension <= SCM_MAX_EXPIRATION_EXTENSION,
+        "extension exceeds SCM_MAX_EXPIRATION_EXTENSION");
+    static_assert(Clocks >= 1 && Clocks <= SCM_MAX_CLOCKS,
+        "clocks exceed SCM_MAX_CLOCKS");
+
+public:
+    static constexpr unsigned int max_extension = MaxExtension;
+    static constexpr unsigned int clocks = Clocks;
+
+    static heap &instance() {
+        static heap h;
+        return h;
+    }
+
+    heap(const heap &) = delete;
+    heap &operator=(const heap &) = delete;
+
+    scm_heap_t *get() const noexcept {
+        return heap_;
+    }
+
+private:
+    heap() : heap_(scm_heap_create(MaxExtension, Clocks)) {
+        if (heap_ == nullptr) throw std::bad_alloc();
+
+        //0 selects the compile time limit in scm_heap_create
+        scm_heap_set_max_extension(heap_, MaxExtension);
+    }
+
+    scm_heap_t *heap_;
+};
+
+/**
+ * Makes a heap the current heap of the calling thread for the duration of
+ * the scope.
+ */
+class heap_scope {
+public:
+    explicit heap_scope(scm_heap_t *heap) noexcept
+        : previous_(scm_heap_switch(heap)) {}
+
+    template <unsigned int MaxExtension, unsigned int Clocks>
+    explicit heap_scope(const heap<MaxExtension, Clocks> &h) noexcept
+        : heap_scope(h.get()) {}
+
+    ~heap_scope() {
+        if (previous_ != nullptr) scm_heap_switch(previous_);
+    }
+
+    heap_scope(const heap_scope &) = delete;
+    heap_scope &operator=(const heap_scope &) = delete;
+
+private:
+    scm_heap_t *previous_;
+};
+
+#ifdef SCM_HAS_MEMORY_RESOURCE
+
+/**
+ * Memory resource over a region, e.g. for std::pmr containers. Blocks that
+ * do not fit into the region come from the upstream resource.
+ */
+class region_resource : public std::pmr::memory_resource {
+public:
+    explicit region_resource(int region,
+            std::pmr::memory_resource *upstream =
+                std::pmr::get_default_resource()) noexcept
+        : region_(region), upstream_(upstream) {}
+
+    int region() const noexcept {
+        return region_;
+    }
+
+    std::pmr::memory_resource *upstream_resource() const noexcept {
+        return upstream_;
+    }
+
+protected:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        if (!fits_into_region(bytes, alignment)) {
+            return upstream_->allocate(bytes, alignment);
+        }
+
+        return region_allocate(region_, bytes);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes,
+            std::size_t alignment) override {
+        if (!fits_into_region(bytes, alignment)) {
+            upstream_->deallocate(p, bytes, alignment);
+        }
+        //else: released with the region
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const
+            noexcept override {
+        const region_resource *r =
+            dynamic_cast<const region_resource*>(&other);
+
+        return r != nullptr && r->region_ == region_
+            && r->upstream_ == upstream_;
+    }
+
+private:
+    int region_;
+    std::pmr::memory_resource *upstream_;
+};
+
+/**
+ * Memory resource of short-term objects that expire after extension ticks
+ * of the clock. Blocks with a larger alignment than short-term objects
+ * provide come from the upstream resource.
+ */
+class short_term_resource : public std::pmr::memory_resource {
+public:
+    explicit short_term_resource(unsigned int extension = 0,
+            unsigned int clock = 0,
+            std::pmr::memory_resource *upstream =
+                std::pmr::get_default_resource()) noexcept
+        : extension_(extension), clock_(clock), upstream_(upstream) {}
+
+    unsigned int extension() const noexcept {
+        return extension_;
+    }
+
+    unsigned int clock() const noexcept {
+        return clock_;
+    }
+
+protected:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+        if (alignment > payload_alignment) {
+            return upstream_->allocate(bytes, alignment);
+        }
+
+        return short_term_allocate(bytes, extension_, clock_);
+    }
+
+    void do_deallocate(void *p, std::size_t bytes,
+            std::size_t alignment) override {
+        if (alignment > payload_alignment) {
+            upstream_->deallocate(p, bytes, alignment);
+        }
+        //else: the block expires with its descriptor
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const
+            noexcept override {
+        const short_term_resource *r =
+            dynamic_cast<const short_term_resource*>(&other);
+
+        return r != nullptr && r->extension_ == extension_
+            && r->clock_ == clock_ && r->upstream_ == upstream_;
+    }
+
+private:
+    unsigned int extension_;
+    unsigned int clock_;
+    std::pmr::memory_resource *upstream_;
+};
+
+#endif /* SCM_HAS_MEMORY_RESOURCE */
+
+#ifdef SCM_HAS_COROUTINES
+
+/**
+ * Awaited by a coroutine whose promise derives from short_term_promise to
+ * obtain its promise without suspending or ticking:
+ *
+ *   auto &frame = co_await scm::this_frame;
+ *   char *buffer = static_cast<char*>(frame.allocate(size));
+ */
+struct this_frame_t {};
+
+constexpr this_frame_t this_frame{};
+
+/**
+ * Mixin for the promise type of a coroutine:
+ *
+ *   struct promise_type : scm::short_term_promise<> { ... };
+ *
+ * The coroutine frame is allocated with scm_malloc and freed with scm_free
+ * when the coroutine is destroyed. Every co_await in the coroutine ticks
+ * Clock before the awaited expression is evaluated for suspension, so a
+ * suspension point is a tick point. A promise type that defines its own
+ * await_transform has to tick itself, e.g. by calling tick().
+ *
+ * Each coroutine creates a region for the memory of the request it
+ * handles, which allocate() bump-allocates into. When the coroutine is
+ * destroyed, the region is refreshed with extension 0 and unregistered,
+ * so it is reclaimed at the next tick of Clock. If no region is
+ * available, allocate() falls back to blocks that are freed when the
+ * coroutine is destroyed. Regions belong to the thread that created the
+ * coroutine, which must be the thread that resumes and destroys it.
+ */
+template <unsigned int Clock = 0>
+class short_term_promise {
+public:
+    static void *operator new(std::size_t size) {
+        void *p = scm_malloc(size);
+
+        if (p == nullptr) throw std::bad_alloc();
+
+        return p;
+    }
+
+    static void operator delete(void *p) noexcept {
+        scm_free(p);
+    }
+
+    short_term_promise() noexcept
+        : region_(scm_create_region()), fallback_blocks_(nullptr) {}
+
+    ~short_term_promise() {
+        //the region expires with the next tick of the clock
+        if (region_ != -1) {
+            scm_refresh_region_with_clock(region_, 0, Clock);
+            scm_unregister_region(region_);
+        }
+
+        while (fallback_blocks_ != nullptr) {
+            void *next = *static_cast<void**>(fallback_blocks_);
+            scm_free(fallback_blocks_);
+            fallback_blocks_ = next;
+        }
+    }
+
+    short_term_promise(const short_term_promise &) = delete;
+    short_term_promise &operator=(const short_term_promise &) = delete;
+
+    /**
+     * Returns the region of the coroutine or -1 if none was available.
+     */
+    int region() const noexcept {
+        return region_;
+    }
+
+    /**
+     * Allocates memory that lives as long as the coroutine. Throws
+     * std::bad_alloc if out of memory.
+     */
+    void *allocate(std::size_t bytes) {
+        if (region_ != -1 && bytes <= max_region_block) {
+            return region_allocate(region_, bytes);
+        }
+
+        //the block is linked through its first word and has no descriptors
+        void **block = static_cast<void**>(
+            scm_malloc(sizeof(void*) + bytes));
+
+        if (block == nullptr) throw std::bad_alloc();
+
+        *block = fallback_blocks_;
+        fallback_blocks_ = block;
+
+        return block + 1;
+    }
+
+    void tick() const noexcept {
+        scm_tick_clock(Clock);
+    }
+
+    template <typename Awaitable>
+    Awaitable &&await_transform(Awaitable &&awaitable) noexcept {
+        tick();
+        return static_cast<Awaitable&&>(awaitable);
+    }
+
+    auto await_transform(this_frame_t) noexcept {
+        struct awaiter {
+            short_term_promise *promise;
+
+            bool await_ready() const noexcept {
+                return true;
+            }
+
+            void await_suspend(std::coroutine_handle<>) const noexcept {}
+
+            short_term_promise &await_resume() const noexcept {
+                return *promise;
+            }
+        };
+
+        return awaiter{this};
+    }
+
+private:
+    int region_;
+    void *fallback_blocks_;
+};
+
+#endif /* SCM_HAS_COROUTINES */
+
+} // namespace scm
+
+#endif	/* _SCM_HPP_ */